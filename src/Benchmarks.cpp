@@ -0,0 +1,195 @@
+#include "Benchmarks.h"
+
+#include "Composition.h"
+#include "Element.h"
+#include "Gfdi.h"
+#include "PhysicalConstants.h"
+#include "PlasmaFunctions.h"
+#include "PlasmaState.h"
+#include "TfdhBvpSolve.h"
+#include "TfdhIon.h"
+#include "TfdhOdeSolve.h"
+#include "TfdhSolution.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+  const double min_batch_seconds = 0.05;
+  const int num_batches = 3;
+
+  // where the results of the timed calls go, so they aren't optimized away
+  volatile double sink;
+
+  // times f(i) for i = 0, 1, ... as described in Benchmarks.h
+  template <typename F>
+  Bench::Result measure(const std::string& benchmark, const std::string& point, const F& f) {
+    typedef std::chrono::steady_clock Clock;
+    const auto batch = [&] (const size_t calls) {
+      const Clock::time_point start = Clock::now();
+      double sum = 0;
+      for (size_t i=0; i<calls; ++i) sum += f(i);
+      sink = sum;
+      return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    size_t calls = 1;
+    double best = batch(calls);
+    while (best < min_batch_seconds) {
+      calls *= 2;
+      best = batch(calls);
+    }
+    for (int b=1; b<num_batches; ++b) best = std::min(best, batch(calls));
+    return {benchmark, point, calls, 1e9 * best / calls};
+  }
+
+  const Element H(1, 1, "H");
+  const Element He(4, 2, "He");
+  const Element C(12, 6, "C");
+  const Element O(16, 8, "O");
+  const Element Fe56(56, 26, "Fe56");
+
+  // a representative plasma state and trace ion
+  struct Point {
+    double rho;
+    double t; // in kelvin
+    std::vector<Species> species;
+    Element ion;
+    bool isRelativistic;
+
+    std::string str() const {
+      std::ostringstream s;
+      s << "rho=" << rho << ",t=" << t << ",comp=";
+      for (size_t i=0; i<species.size(); ++i)
+        s << (i ? "+" : "") << species[i].element.name << ":" << species[i].massFraction;
+      s << ",ion=" << ion.name << (isRelativistic ? ",rel" : "");
+      return s.str();
+    }
+  };
+
+  // from weakly coupled and non-degenerate to strongly degenerate
+  const std::vector<Point> points = {
+    {1e-2, 1e8, {{0.7, He}, {0.3, H}}, O, false},
+    {1e2, 1e7, {{0.7, He}, {0.3, H}}, Fe56, false},
+    {1e3, 1e8, {{0.7, He}, {0.3, H}}, Fe56, false}, // the example point of tfdh.cpp
+    {1e5, 1e7, {{1.0, C}}, O, false},
+    {1e7, 1e7, {{0.5, C}, {0.5, O}}, Fe56, false},
+    {1e8, 1e9, {{1.0, C}}, Fe56, true}};
+
+} // helper namespace
+
+
+
+std::vector<Bench::Result> Bench::run()
+{
+  std::vector<Result> results;
+
+  // gfdi per order, in each regime of its approximation, with and without
+  // the relativistic terms
+  const struct {const char* name; double lo; double hi;} regimes[] = {
+    {"small", -10.0, 0.5}, {"mid", 1.0, 13.0}, {"large", 15.0, 100.0}};
+  const size_t num_chis = 64;
+  for (const double tau : {0.0, 1e-2}) {
+    for (const auto& regime : regimes) {
+      std::vector<double> chis(num_chis);
+      for (size_t i=0; i<num_chis; ++i)
+        chis[i] = regime.lo + (regime.hi - regime.lo) * i / (num_chis-1);
+      for (const GFDI order : {GFDI::Order12, GFDI::Order32, GFDI::Order52}) {
+        std::ostringstream point;
+        point << "order=" << (order==GFDI::Order12 ? "12" : (order==GFDI::Order32 ? "32" : "52"))
+          << ",regime=" << regime.name << ",tau=" << tau;
+        results.push_back(measure("gfdi", point.str(),
+              [&] (const size_t i) {return gfdi(order, chis[i % num_chis], tau);}));
+      }
+    }
+  }
+
+  const double& qe = PhysicalConstantsCGS::ElectronCharge;
+  const double& kB = PhysicalConstantsCGS::KBoltzmann;
+  for (const Point& pt : points) {
+    const Composition comp(pt.species);
+    const PlasmaState ps(pt.rho, pt.t * kB, comp, pt.isRelativistic);
+    const Element& e = pt.ion;
+    const std::string where = pt.str();
+
+    // the setup of the state, dominated by the inversion for chi
+    results.push_back(measure("PlasmaState", where,
+          [&] (size_t) {return PlasmaState(pt.rho, pt.t * kB, comp, pt.isRelativistic).chi;}));
+
+    // the densities and the ODE along the solution's own profile
+    const TfdhSolution tfdh = TFDH::solve(e, ps);
+    const std::vector<double>& r = tfdh.r;
+    const std::vector<double>& phi = tfdh.phi;
+    const size_t n = r.size();
+    results.push_back(measure("Plasma::ne", where,
+          [&] (const size_t i) {return Plasma::ne(phi[i % n], ps);}));
+    results.push_back(measure("Plasma::neBound", where,
+          [&] (const size_t i) {return Plasma::neBound(phi[i % n], ps);}));
+    results.push_back(measure("tfdhOdeRhs", where, [&] (const size_t i) {
+          const double f[2] = {r[i % n] * phi[i % n] / qe, tfdh.dv0};
+          double dfdr[2];
+          TFDH::odeRhs(e, ps, r[i % n], f, dfdr);
+          return dfdr[1];
+        }));
+    const struct {const char* name; TFDH::Stepper stepper;} steppers[] = {
+      {"explicit", TFDH::Stepper::Explicit}, {"implicit", TFDH::Stepper::Implicit}};
+    const struct {const char* name; TFDH::Coordinate coordinate;} coordinates[] = {
+      {"r", TFDH::Coordinate::Radius}, {"lnr", TFDH::Coordinate::LogRadius}};
+    for (const auto& s : steppers) {
+      for (const auto& c : coordinates) {
+        const std::string point = std::string("stepper=") + s.name + ",coordinate=" + c.name + "," + where;
+        results.push_back(measure("integrateODE", point,
+              [&] (size_t) {return TFDH::integrateTrajectory(e, ps, tfdh.dv0, s.stepper, c.coordinate);}));
+      }
+    }
+
+    // the search for the shooting parameter, from a cold start
+    const struct {const char* name; TFDH::Shooting method;} methods[] = {
+      {"bisection", TFDH::Shooting::Bisection}, {"newton", TFDH::Shooting::Newton},
+      {"multisection", TFDH::Shooting::Multisection}};
+    for (const auto& m : methods) {
+      results.push_back(measure("findPotentialRoot", std::string("method=") + m.name + "," + where,
+            [&] (size_t) {return TFDH::solve(e, ps, m.method).dv0;}));
+    }
+    // the same solution by relaxation instead
+    results.push_back(measure("solveRelaxation", where,
+          [&] (size_t) {return TFDH::solveRelaxation(e, ps).dv0;}));
+
+    // end to end, as the sweeps use it
+    results.push_back(measure("TfdhIon", where,
+          [&] (size_t) {return TfdhIon(ps, e).numberBoundElectrons;}));
+  }
+
+  return results;
+}
+
+
+void Bench::printResultsToFile(const std::string& filename, const std::vector<Result>& results,
+    const std::string& label, const std::string& time)
+{
+  std::ofstream outfile(filename);
+  assert(outfile and "couldn't open file");
+  outfile.precision(6);
+
+  outfile << "# benchmarks of the TFDH ion-in-plasma calculation\n";
+  outfile << "# code version " << label << "\n";
+  outfile << "# code run on " << time << "\n";
+  outfile << "#\n";
+  outfile << "# col #0 = benchmark\n";
+  outfile << "# col #1 = point\n";
+  outfile << "# col #2 = calls per batch\n";
+  outfile << "# col #3 = time per call [ns]\n";
+
+  const std::string sep = "    ";
+  for (const Result& result : results) {
+    outfile << result.benchmark << sep << result.point
+      << sep << result.calls << sep << result.nsPerCall << "\n";
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef TFDH_BENCHMARKS_H
+#define TFDH_BENCHMARKS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+// Timings of the hot functions (gfdi, the Plasma:: densities, the setup of a
+// PlasmaState, the ODE, the shooting and the relaxation) and of whole TfdhIon
+// solves, at a fixed set of representative plasma states -- from weakly
+// coupled to degenerate and relativistic -- so that runs of different
+// versions of the code can be compared.
+//
+// Each benchmark calls its function in batches, doubling the batch until one
+// takes at least 50 ms, and reports the fastest of three such batches (the
+// least disturbed by the rest of the machine) as the time per call.
+namespace Bench {
+
+  struct Result {
+    std::string benchmark; // the function timed, e.g. "gfdi"
+    std::string point;     // its arguments, e.g. "order=12,regime=mid,tau=0"
+    size_t calls;          // per batch
+    double nsPerCall;
+  };
+
+  std::vector<Result> run();
+
+  // one row per result, whitespace-separated: benchmark, point, calls, ns per
+  // call; label identifies the version of the code, e.g. a git revision
+  void printResultsToFile(const std::string& filename, const std::vector<Result>& results,
+      const std::string& label, const std::string& time="<no time given>");
+
+}
+
+
+#endif // TFDH_BENCHMARKS_H
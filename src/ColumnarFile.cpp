@@ -0,0 +1,169 @@
+#include "ColumnarFile.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+  const char magic[8] = {'T', 'F', 'D', 'H', 'C', 'O', 'L', '1'};
+
+  void writeUint(std::ofstream& out, const uint64_t n) {
+    out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+  }
+
+  void writeDouble(std::ofstream& out, const double x) {
+    out.write(reinterpret_cast<const char*>(&x), sizeof(x));
+  }
+
+  void writeString(std::ofstream& out, const std::string& s) {
+    const char padding[8] = {};
+    writeUint(out, s.size());
+    out.write(s.data(), s.size());
+    out.write(padding, (8 - s.size()%8) % 8);
+  }
+
+  // sequential reads from a mapped file, checked against its end
+  class Cursor {
+    public:
+      Cursor(const char* data, const size_t size) : data(data), size(size), pos(0) {}
+
+      uint64_t readUint() {
+        uint64_t n;
+        std::memcpy(&n, advance(sizeof(n)), sizeof(n));
+        return n;
+      }
+      double readDouble() {
+        double x;
+        std::memcpy(&x, advance(sizeof(x)), sizeof(x));
+        return x;
+      }
+      std::string readString() {
+        const uint64_t length = readUint();
+        const char* s = advance((length + 7) / 8 * 8);
+        return std::string(s, length);
+      }
+      const char* advance(const size_t bytes) {
+        assert(bytes <= size - pos and "columnar file is truncated");
+        const char* p = data + pos;
+        pos += bytes;
+        return p;
+      }
+
+    private:
+      const char* data;
+      const size_t size;
+      size_t pos;
+  };
+
+} // helper namespace
+
+
+
+void Columnar::write(const std::string& filename, const Table& table)
+{
+  assert(table.columnNames.size() == table.columns.size());
+  const size_t numRows = table.columns.empty() ? 0 : table.columns.front().size();
+  for (const auto& column : table.columns)
+    assert(column.size() == numRows and "columns must be of equal length");
+
+  std::ofstream outfile(filename, std::ios::binary);
+  assert(outfile and "couldn't open file");
+
+  outfile.write(magic, sizeof(magic));
+  writeUint(outfile, table.text.size());
+  writeUint(outfile, table.scalars.size());
+  writeUint(outfile, table.columns.size());
+  writeUint(outfile, numRows);
+  for (const auto& field : table.text) {
+    writeString(outfile, field.first);
+    writeString(outfile, field.second);
+  }
+  for (const auto& field : table.scalars) {
+    writeString(outfile, field.first);
+    writeDouble(outfile, field.second);
+  }
+  for (const std::string& name : table.columnNames) {
+    writeString(outfile, name);
+  }
+  for (const auto& column : table.columns) {
+    outfile.write(reinterpret_cast<const char*>(column.data()), column.size()*sizeof(double));
+  }
+  assert(outfile and "couldn't write file");
+}
+
+
+
+Columnar::Reader::Reader(const std::string& filename)
+: file(filename),
+  rows(0),
+  data(nullptr)
+{
+  assert(file.data and "couldn't open columnar file");
+  Cursor cursor(file.data, file.size);
+  const char* const fileMagic = cursor.advance(sizeof(magic));
+  assert(std::memcmp(fileMagic, magic, sizeof(magic)) == 0 and "not a columnar file");
+
+  const uint64_t numText = cursor.readUint();
+  const uint64_t numScalars = cursor.readUint();
+  const uint64_t numColumns = cursor.readUint();
+  rows = cursor.readUint();
+  for (uint64_t i=0; i<numText; ++i) {
+    const std::string key = cursor.readString();
+    textFields[key] = cursor.readString();
+  }
+  for (uint64_t i=0; i<numScalars; ++i) {
+    const std::string name = cursor.readString();
+    scalarFields[name] = cursor.readDouble();
+  }
+  for (uint64_t i=0; i<numColumns; ++i) {
+    names.push_back(cursor.readString());
+  }
+  data = reinterpret_cast<const double*>(cursor.advance(numColumns*rows*sizeof(double)));
+}
+
+
+const double* Columnar::Reader::column(const size_t index) const
+{
+  assert(index < names.size());
+  return data + index*rows;
+}
+
+
+const double* Columnar::Reader::column(const std::string& name) const
+{
+  for (size_t i=0; i<names.size(); ++i) {
+    if (names[i] == name) return column(i);
+  }
+  assert(false and "no such column");
+  return nullptr;
+}
+
+
+bool Columnar::Reader::hasColumn(const std::string& name) const
+{
+  for (const std::string& n : names) {
+    if (n == name) return true;
+  }
+  return false;
+}
+
+
+double Columnar::Reader::scalar(const std::string& name) const
+{
+  const auto it = scalarFields.find(name);
+  assert(it != scalarFields.end() and "no such scalar");
+  return it->second;
+}
+
+
+const std::string& Columnar::Reader::text(const std::string& key) const
+{
+  const auto it = textFields.find(key);
+  assert(it != textFields.end() and "no such text field");
+  return it->second;
+}
@@ -0,0 +1,68 @@
+#ifndef TFDH_COLUMNAR_FILE_H
+#define TFDH_COLUMNAR_FILE_H
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// A binary, column-major table format for the output files, readable without
+// parsing text and without loss of precision.
+//
+// A file holds named text fields (e.g. the composition), named scalars (e.g.
+// rho, t), and a table of named columns of doubles sharing one row count.
+// Layout, all in native byte order and in 8-byte units:
+//   "TFDHCOL1", then numText, numScalars, numColumns, numRows (uint64 each)
+//   numText x (key, value) strings
+//   numScalars x (name string, double)
+//   numColumns x name string
+//   numColumns x numRows doubles, one column after the other
+// where a string is a uint64 length followed by its bytes, zero-padded to a
+// multiple of 8. The columns are therefore 8-byte aligned in the file, and a
+// Reader serves them straight from a memory mapping.
+namespace Columnar {
+
+  struct Table {
+    std::vector<std::pair<std::string, std::string>> text;
+    std::vector<std::pair<std::string, double>> scalars;
+    std::vector<std::string> columnNames;
+    std::vector<std::vector<double>> columns; // each of the same length
+  };
+
+  void write(const std::string& filename, const Table& table);
+
+  class Reader {
+    public:
+      explicit Reader(const std::string& filename);
+
+      size_t numRows() const { return rows; }
+      const std::vector<std::string>& columnNames() const { return names; }
+
+      // pointer to the numRows() values of a column, valid while the Reader
+      // lives; slices are just offsets into it
+      const double* column(size_t index) const;
+      const double* column(const std::string& name) const;
+      bool hasColumn(const std::string& name) const;
+
+      double scalar(const std::string& name) const;
+      const std::string& text(const std::string& key) const;
+      const std::map<std::string, double>& scalars() const { return scalarFields; }
+      const std::map<std::string, std::string>& texts() const { return textFields; }
+
+    private:
+      const MappedFile file;
+      size_t rows;
+      std::map<std::string, std::string> textFields;
+      std::map<std::string, double> scalarFields;
+      std::vector<std::string> names;
+      const double* data;
+  };
+
+}
+
+
+#endif // TFDH_COLUMNAR_FILE_H
@@ -0,0 +1,89 @@
+#include "CubicSpline.h"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+
+CubicSpline::CubicSpline(const std::vector<double>& x, const std::vector<double>& f)
+: segments(x.size()-1),
+  xmin(x.front()),
+  xmax(x.back()),
+  bucketsPerUnit(0),
+  firstInterval(x.size(), 0)
+{
+  assert(x.size()==f.size());
+  assert(x.size() >= 2 and "need at least two points to interpolate");
+  const size_t n = x.size();
+  const size_t numIntervals = n-1;
+
+  // second derivatives / 2 at the mesh points, zero at the ends (natural
+  // spline), from the usual tridiagonal system -- solved by forward
+  // elimination and back substitution
+  std::vector<double> c(n, 0.0);
+  std::vector<double> diag(n, 1.0);
+  std::vector<double> rhs(n, 0.0);
+  for (size_t i=1; i<n-1; ++i) {
+    const double hl = x[i] - x[i-1];
+    const double hr = x[i+1] - x[i];
+    diag[i] = 2.0*(hl + hr);
+    rhs[i] = 3.0*((f[i+1]-f[i])/hr - (f[i]-f[i-1])/hl);
+    if (i > 1) {
+      const double m = hl/diag[i-1];
+      diag[i] -= m*hl;
+      rhs[i] -= m*rhs[i-1];
+    }
+  }
+  for (size_t i=n-2; i>=1; --i) {
+    c[i] = (rhs[i] - (x[i+1]-x[i])*c[i+1]) / diag[i];
+  }
+
+  for (size_t i=0; i<numIntervals; ++i) {
+    const double h = x[i+1] - x[i];
+    assert(h > 0 and "need monotonically increasing x");
+    segments[i] = {x[i], f[i],
+      (f[i+1]-f[i])/h - h*(c[i+1] + 2.0*c[i])/3.0,
+      c[i],
+      (c[i+1]-c[i])/(3.0*h)};
+  }
+
+  // one bucket per interval. firstInterval[k+1] is the last interval starting
+  // in bucket k or below, so a point in bucket k lies in one of the intervals
+  // firstInterval[k] to firstInterval[k+1]. the mesh points are binned with
+  // the same arithmetic as the lookups, so rounding can't misplace them
+  bucketsPerUnit = numIntervals / (xmax - xmin);
+  size_t i = 0;
+  for (size_t k=0; k<numIntervals; ++k) {
+    while (i+1 < numIntervals and bucketCoordinate(x[i+1]) < k+1) ++i;
+    firstInterval[k+1] = i;
+  }
+  firstInterval.back() = numIntervals-1; // the lookups clamp into the last bucket
+}
+
+
+double CubicSpline::eval(const double x) const
+{
+  assert(x >= xmin and x <= xmax and "spline evaluated outside its mesh");
+  const Segment& s = segments[interval(x)];
+  const double dx = x - s.x;
+  return s.y + dx*(s.b + dx*(s.c + dx*s.d));
+}
+
+
+double CubicSpline::bucketCoordinate(const double x) const
+{
+  return (x - xmin) * bucketsPerUnit;
+}
+
+
+size_t CubicSpline::interval(const double x) const
+{
+  const double u = bucketCoordinate(x);
+  const size_t k = (u > 0) ? std::min(static_cast<size_t>(u), segments.size()-1) : 0;
+  const size_t lo = firstInterval[k];
+  const size_t hi = firstInterval[k+1];
+  // the last interval in [lo, hi] that starts at or below x
+  const auto after = std::upper_bound(segments.begin()+lo+1, segments.begin()+hi+1, x,
+      [](const double value, const Segment& s) { return value < s.x; });
+  return (after - segments.begin()) - 1;
+}
@@ -0,0 +1,48 @@
+#ifndef TFDH_CUBIC_SPLINE_H
+#define TFDH_CUBIC_SPLINE_H
+
+#include <cstddef>
+#include <vector>
+
+
+// natural cubic spline through (x, f), the same interpolant as GSL's
+// gsl_interp_cspline.
+//
+// unlike a gsl_spline with its gsl_interp_accel, evaluation keeps no state:
+// one spline may be evaluated from any number of threads at once, and copies
+// are independent values. the coefficients of each interval are stored
+// together, in one contiguous array.
+//
+// the interval holding a point is found through a table of buckets uniform in
+// x, so that lookups on a roughly uniform mesh take constant time -- e.g. the
+// TFDH radii, which TfdhSolution passes as ln r
+class CubicSpline {
+  public:
+    CubicSpline(const std::vector<double>& x, const std::vector<double>& f);
+
+    // x must lie within the mesh
+    double eval(double x) const;
+
+  private:
+    // on [x, x_next): f = y + dx*(b + dx*(c + dx*d)), with dx the offset from x
+    struct Segment {
+      double x;
+      double y;
+      double b;
+      double c;
+      double d;
+    };
+
+    size_t interval(double x) const;
+    double bucketCoordinate(double x) const;
+
+    std::vector<Segment> segments; // one per mesh interval
+    double xmin;
+    double xmax;
+    double bucketsPerUnit;
+    // bucket k covers intervals firstInterval[k] to firstInterval[k+1]
+    std::vector<size_t> firstInterval;
+};
+
+
+#endif // TFDH_CUBIC_SPLINE_H
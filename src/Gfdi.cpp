@@ -1,9 +1,14 @@
 
 #include "Gfdi.h"
 
+#include "Instrumentation.h"
+
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 
 
 // helper functions and data
@@ -58,29 +63,73 @@ namespace {
     }
   }
 
-  inline double gfdi_small(const int k, const double chi, const double tau) {
+  const auto expMinusKhi = [] () {
+    std::array<std::array<double, 5>, 3> e;
+    for (int k=0; k<3; ++k)
+      for (size_t i=0; i<5; ++i)
+        e[k][i] = exp(-khi[k][i]);
+    return e;
+  }();
+
+
+  // the regimes below are specialized at compile time for the order K and
+  // for the non-relativistic limit: with Rel false, tau is exactly 0 and the
+  // relativistic factors drop out, and the powers of chi with exponents
+  // known at compile time become products and square roots
+
+  // a^K as a product
+  template <int K>
+  inline double ipow(const double a) {
+    return a * ipow<K-1>(a);
+  }
+  template <>
+  inline double ipow<0>(const double) {
+    return 1.0;
+  }
+
+  // the relativistic correction sqrt(1 + a tau/2), exactly 1 if tau == 0
+  template <bool Rel>
+  inline double relativisticFactor(const double a, const double tau) {
+    return Rel ? sqrt(1 + a*tau/2) : 1.0;
+  }
+
+  template <int K, bool Rel>
+  inline double gfdi_small(const double chi, const double tau) {
+    const double emchi = exp(-chi);
     double value = 0;
-    for (size_t i=1; i<=5; ++i) {
-      value += c[k][i-1] * sqrt(1 + khi[k][i-1]*tau/2) /
-        (exp(-khi[k][i-1]) + exp(-chi));
+    for (size_t i=0; i<5; ++i) {
+      value += c[K][i] * relativisticFactor<Rel>(khi[K][i], tau) /
+        (expMinusKhi[K][i] + emchi);
     }
     return value;
   }
 
-  inline double gfdi_mid(const int k, const double chi, const double tau) {
+  template <int K, bool Rel>
+  inline double gfdi_mid(const double chi, const double tau) {
+    const double chiPower = ipow<K+1>(chi) * sqrt(chi); // chi^(k+3/2)
     double value = 0;
-    for (size_t i=1; i<=5; ++i) {
-      value += h[i-1] * pow(x[i-1], k) * pow(chi, k+3./2)
-        * sqrt(1 + chi*x[i-1]*tau/2) / (1 + exp(chi*(x[i-1] - 1)))
-        + v[i-1] * pow(xi[i-1] + chi, k+1./2) * sqrt(1 + (xi[i-1] + chi)*tau/2);
+    for (size_t i=0; i<5; ++i) {
+      const double xc = xi[i] + chi;
+      value += h[i] * ipow<K>(x[i]) * chiPower
+        * relativisticFactor<Rel>(chi*x[i], tau) / (1 + exp(chi*(x[i] - 1)))
+        + v[i] * ipow<K>(xc) * sqrt(xc) * relativisticFactor<Rel>(xc, tau);
     }
     return value;
   }
 
-  inline double gfdi_large(const int k, const double chi, const double tau) {
-    const double R = sqrt(chi*(1 + chi*tau/2));
-    return Fk(k, chi, tau, R)
-      + M_PI*M_PI/6. * pow(chi, k) * (k + 1./2 + (k+1)*chi*tau/2) / R;
+  template <int K, bool Rel>
+  inline double gfdi_large(const double chi, const double tau) {
+    const double R = Rel ? sqrt(chi*(1 + chi*tau/2)) : sqrt(chi);
+    // F_k reduces to its chi*tau -> 0 limit in the non-relativistic case
+    const double F = (not Rel) ? ipow<K+1>(chi) * sqrt(chi) / (K+3./2) : Fk(K, chi, tau, R);
+    return F + M_PI*M_PI/6. * ipow<K>(chi) * (K + 1./2 + (Rel ? (K+1)*chi*tau/2 : 0)) / R;
+  }
+
+  // gfdi_large for an order known only at run time, at any tau
+  double gfdi_large(const int k, const double chi, const double tau) {
+    return (k == 0) ? gfdi_large<0, true>(chi, tau)
+      : (k == 1) ? gfdi_large<1, true>(chi, tau)
+      : gfdi_large<2, true>(chi, tau);
   }
 
   // a cubic transition function which satisfies
@@ -93,34 +142,385 @@ namespace {
     return fl + fz*(fr-fl);
   }
 
+
+  // the three regimes above, for all orders at once: each fills value[k] and,
+  // if dchi is non-null, dchi[k] = d(value[k])/d(chi). specialized for the
+  // non-relativistic limit like the single-order versions
+  typedef std::array<double, 3> Orders;
+
+  template <bool Rel>
+  void all_small(const double chi, const double tau, Orders& value, Orders* dchi) {
+    const double emchi = exp(-chi);
+    for (int k=0; k<3; ++k) {
+      value[k] = 0;
+      if (dchi) (*dchi)[k] = 0;
+      for (size_t i=0; i<5; ++i) {
+        const double num = c[k][i] * relativisticFactor<Rel>(khi[k][i], tau);
+        const double inv = 1 / (expMinusKhi[k][i] + emchi);
+        value[k] += num * inv;
+        if (dchi) (*dchi)[k] += num * emchi * inv*inv;
+      }
+    }
+  }
+
+  template <bool Rel>
+  void all_mid(const double chi, const double tau, Orders& value, Orders* dchi) {
+    value = Orders {{0, 0, 0}};
+    if (dchi) *dchi = Orders {{0, 0, 0}};
+    const double sqrtChi = sqrt(chi);
+    for (size_t i=0; i<5; ++i) {
+      const double ex = exp(chi*(x[i] - 1));
+      const double fermi = 1 / (1 + ex);
+      const double s1 = relativisticFactor<Rel>(chi*x[i], tau);
+      const double xc = xi[i] + chi;
+      const double sqrtXc = sqrt(xc);
+      const double s2 = relativisticFactor<Rel>(xc, tau);
+
+      // the order-k terms carry extra factors x^k, chi^k and (xi+chi)^k
+      double xk = 1, chik = 1, xck = 1;
+      for (int k=0; k<3; ++k) {
+        const double t1 = h[i] * xk * chik*chi*sqrtChi * s1 * fermi;
+        const double t2 = v[i] * xck*sqrtXc * s2;
+        value[k] += t1 + t2;
+        if (dchi) {
+          (*dchi)[k] += t1 * ((k + 3./2)/chi + (Rel ? x[i]*tau/(4*s1*s1) : 0) - fermi*ex*(x[i] - 1))
+            + t2 * ((k + 1./2)/xc + (Rel ? tau/(4*s2*s2) : 0));
+        }
+        xk *= x[i];
+        chik *= chi;
+        xck *= xc;
+      }
+    }
+  }
+
+  template <bool Rel>
+  void all_large(const double chi, const double tau, Orders& value, Orders* dchi) {
+    const double R = Rel ? sqrt(chi*(1 + chi*tau/2)) : sqrt(chi);
+    const double dR = Rel ? (1 + chi*tau) / (2*R) : 1 / (2*R);
+
+    // F_k by the same recursion as in Fk(), along with dF_k/dchi = chi^k R
+    Orders F;
+    const bool smallChiTau = (not Rel) or chi*tau < 1.e-4;
+    if (smallChiTau) {
+      double chiPower = chi*sqrt(chi); // chi^(k+3/2)
+      for (int k=0; k<3; ++k) {
+        F[k] = chiPower/(k+3./2);
+        chiPower *= chi;
+      }
+    } else {
+      F[0] = (chi + 1/tau)*R/2 - pow(2*tau, -3./2) * log(1 + tau*chi + sqrt(2*tau)*R);
+      F[1] = (2./3*cube(R) - F[0]) / tau;
+      F[2] = (2*chi*cube(R) - 5*F[1]) / (4*tau);
+    }
+
+    double chik = 1;
+    for (int k=0; k<3; ++k) {
+      const double a = k + 1./2 + (Rel ? (k+1)*chi*tau/2 : 0);
+      value[k] = F[k] + M_PI*M_PI/6. * chik * a / R;
+      if (dchi) {
+        const double dF = smallChiTau ? chik*sqrt(chi) : chik*R;
+        const double dchik = (k==0) ? 0 : k*chik/chi;
+        (*dchi)[k] = dF + M_PI*M_PI/6. * (dchik*a/R + (Rel ? chik*(k+1)*tau/(2*R) : 0) - chik*a*dR/(R*R));
+      }
+      chik *= chi;
+    }
+  }
+
+  // derivative of transition() with respect to x
+  inline double dtransition(const double fl, const double fr, const double dfl,
+      const double dfr, const double x, const double xl, const double xr) {
+    const double z = (x-xl)/(xr-xl);
+    const double fz = 3.*z*z - 2.*cube(z);
+    const double dfz = 6.*z*(1-z) / (xr-xl);
+    return dfl + fz*(dfr-dfl) + dfz*(fr-fl);
+  }
+
+  // round to the nearest integer by letting the FPU do it -- unlike floor(),
+  // this vectorizes without needing -fno-trapping-math
+  inline double roundToInt(const double a) {
+    const double magic = 6755399441055744.0; // 1.5 * 2^52
+    return (a + magic) - magic;
+  }
+
+  // 2^n for integer n in [-1022, 1023], built directly from the bits
+  inline double pow2(const double n) {
+    // n + 2^52 + 1023 holds the biased exponent in its low mantissa bits
+    const double shifted = n + (4503599627370496.0 + 1023);
+    uint64_t bits;
+    std::memcpy(&bits, &shifted, sizeof(bits));
+    bits <<= 52;
+    double result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+  }
+
+  // exp(x) written without branches or library calls, so that loops calling it
+  // can be vectorized. the reduced argument r = x - n ln2 lies in [-ln2/2, ln2/2]
+  // where a degree-13 Taylor polynomial is accurate to roundoff, and the result
+  // is scaled by 2^n in two halves so that overflow and gradual underflow
+  // happen just as they do in exp().
+  inline double vexp(double x) {
+    x = std::max(-1000.0, std::min(x, 1000.0));
+    const double n = roundToInt(x*M_LOG2E);
+    const double ln2hi = 6.93147180369123816490e-01;
+    const double ln2lo = 1.90821492927058770002e-10;
+    const double r = (x - n*ln2hi) - n*ln2lo;
+    double p = 1./6227020800;
+    p = p*r + 1./479001600;
+    p = p*r + 1./39916800;
+    p = p*r + 1./3628800;
+    p = p*r + 1./362880;
+    p = p*r + 1./40320;
+    p = p*r + 1./5040;
+    p = p*r + 1./720;
+    p = p*r + 1./120;
+    p = p*r + 1./24;
+    p = p*r + 1./6;
+    p = p*r + 1./2;
+    p = p*r + 1.;
+    p = p*r + 1.;
+    const double n1 = roundToInt(n/2);
+    return p * pow2(n1) * pow2(n-n1);
+  }
+
+  // the batch evaluation works on chunks of this many points at a time, so
+  // that all scratch arrays live on the stack
+  const size_t chunk = 64;
+
+  // gfdi_small for all orders (skipping null outputs) at m points
+  void batch_small(const double* chi, const size_t m, const double tau,
+      double* const out[3]) {
+    double emchi[chunk];
+    for (size_t j=0; j<m; ++j) emchi[j] = vexp(-chi[j]);
+
+    for (int k=0; k<3; ++k) {
+      if (not out[k]) continue;
+      double num[5], den[5];
+      for (size_t i=0; i<5; ++i) {
+        num[i] = c[k][i] * sqrt(1 + khi[k][i]*tau/2);
+        den[i] = exp(-khi[k][i]);
+      }
+      for (size_t j=0; j<m; ++j) {
+        double value = 0;
+        for (size_t i=0; i<5; ++i) value += num[i] / (den[i] + emchi[j]);
+        out[k][j] = value;
+      }
+    }
+  }
+
+  // gfdi_mid for all orders (skipping null outputs) at m points
+  void batch_mid(const double* chi, const size_t m, const double tau,
+      double* const out[3]) {
+    // the factors of the five terms which don't depend on the order
+    double fermi[5][chunk], bose[5][chunk], shift[5][chunk];
+    for (size_t i=0; i<5; ++i) {
+      for (size_t j=0; j<m; ++j) {
+        const double xc = xi[i] + chi[j];
+        fermi[i][j] = h[i] * sqrt(1 + chi[j]*x[i]*tau/2) / (1 + vexp(chi[j]*(x[i] - 1)));
+        bose[i][j] = v[i] * sqrt(xc) * sqrt(1 + xc*tau/2);
+        shift[i][j] = xc;
+      }
+    }
+
+    double chik[chunk]; // chi^(k+3/2), updated order by order
+    for (size_t j=0; j<m; ++j) chik[j] = chi[j] * sqrt(chi[j]);
+    double xk[5] = {1, 1, 1, 1, 1}; // x^k
+    for (int k=0; k<3; ++k) {
+      if (out[k]) {
+        for (size_t j=0; j<m; ++j) {
+          double value = 0;
+          for (size_t i=0; i<5; ++i) value += xk[i] * chik[j] * fermi[i][j] + bose[i][j];
+          out[k][j] = value;
+        }
+      }
+      for (size_t i=0; i<5; ++i) xk[i] *= x[i];
+      for (size_t j=0; j<m; ++j) chik[j] *= chi[j];
+      for (size_t i=0; i<5; ++i)
+        for (size_t j=0; j<m; ++j) bose[i][j] *= shift[i][j];
+    }
+  }
+
 } // end anonymous namespace
 
 
 
-double gfdi(const GFDI order, const double chi, const double tau) {
+template <GFDI order, bool relativistic>
+double gfdi(const double chi, const double tau) {
   assert(tau <= 100. and "Outside of known convergence region for analytic approx.");
+  assert((relativistic or tau == 0) and "non-relativistic gfdi needs tau == 0");
+  Instrumentation::count(Instrumentation::Probe::Gfdi);
 
   const int k = static_cast<int>(order);
 
   if (chi <= 0.59) {
-    return gfdi_small(k, chi, tau);
+    return gfdi_small<k, relativistic>(chi, tau);
   }
   // smooth the transition from chi being "small" to "mid" over 0.59 -> 0.61
   else if (chi < 0.61) {
-    const double gs = gfdi_small(k, chi, tau);
-    const double gm = gfdi_mid(k, chi, tau);
+    const double gs = gfdi_small<k, relativistic>(chi, tau);
+    const double gm = gfdi_mid<k, relativistic>(chi, tau);
     return transition(gs, gm, chi, 0.59, 0.61);
   }
   else if (chi <= 13.9) {
-    return gfdi_mid(k, chi, tau);
+    return gfdi_mid<k, relativistic>(chi, tau);
   }
   // smooth the "mid" to "large" transition over 13.9 -> 14.1
   else if (chi < 14.1) {
-    const double gm = gfdi_mid(k, chi, tau);
-    const double gl = gfdi_large(k, chi, tau);
+    const double gm = gfdi_mid<k, relativistic>(chi, tau);
+    const double gl = gfdi_large<k, relativistic>(chi, tau);
     return transition(gm, gl, chi, 13.9, 14.1);
   }
   else {
-    return gfdi_large(k, chi, tau);
+    return gfdi_large<k, relativistic>(chi, tau);
   }
 }
+
+template double gfdi<GFDI::Order12, false>(double, double);
+template double gfdi<GFDI::Order32, false>(double, double);
+template double gfdi<GFDI::Order52, false>(double, double);
+template double gfdi<GFDI::Order12, true>(double, double);
+template double gfdi<GFDI::Order32, true>(double, double);
+template double gfdi<GFDI::Order52, true>(double, double);
+
+
+double gfdi(const GFDI order, const double chi, const double tau) {
+  const bool rel = (tau != 0);
+  switch (order) {
+    case GFDI::Order12:
+      return rel ? gfdi<GFDI::Order12, true>(chi, tau) : gfdi<GFDI::Order12, false>(chi, tau);
+    case GFDI::Order32:
+      return rel ? gfdi<GFDI::Order32, true>(chi, tau) : gfdi<GFDI::Order32, false>(chi, tau);
+    default:
+      return rel ? gfdi<GFDI::Order52, true>(chi, tau) : gfdi<GFDI::Order52, false>(chi, tau);
+  }
+}
+
+
+void gfdi(const GFDI order, const double* chi, const size_t n, const double tau,
+    double* result) {
+  double* out[3] = {nullptr, nullptr, nullptr};
+  out[static_cast<int>(order)] = result;
+  gfdi(chi, n, tau, out[0], out[1], out[2]);
+}
+
+
+void gfdi(const double* chi, const size_t n, const double tau,
+    double* i12, double* i32, double* i52) {
+  assert(tau <= 100. and "Outside of known convergence region for analytic approx.");
+  Instrumentation::count(Instrumentation::Probe::Gfdi, n);
+
+  double* const result[3] = {i12, i32, i52};
+  for (size_t start=0; start<n; start+=chunk) {
+    const size_t m = std::min(chunk, n-start);
+    const double* chis = chi + start;
+
+    // sort the points of this chunk by which approximations they need, where
+    // points in the blending regions need two
+    double cs[chunk], cm[chunk];
+    size_t ps[chunk], pm[chunk];
+    size_t ns = 0, nm = 0;
+    for (size_t j=0; j<m; ++j) {
+      if (chis[j] < 0.61) {
+        ps[j] = ns;
+        cs[ns++] = chis[j];
+      }
+      if (chis[j] > 0.59 and chis[j] < 14.1) {
+        pm[j] = nm;
+        cm[nm++] = chis[j];
+      }
+    }
+
+    double vs[3][chunk], vm[3][chunk];
+    double* const outs[3] = {result[0] ? vs[0] : nullptr, result[1] ? vs[1] : nullptr,
+      result[2] ? vs[2] : nullptr};
+    double* const outm[3] = {result[0] ? vm[0] : nullptr, result[1] ? vm[1] : nullptr,
+      result[2] ? vm[2] : nullptr};
+    if (ns > 0) batch_small(cs, ns, tau, outs);
+    if (nm > 0) batch_mid(cm, nm, tau, outm);
+
+    // assemble, blending as in the scalar gfdi()
+    for (int k=0; k<3; ++k) {
+      if (not result[k]) continue;
+      for (size_t j=0; j<m; ++j) {
+        const double cj = chis[j];
+        double& value = result[k][start+j];
+        if (cj <= 0.59) {
+          value = vs[k][ps[j]];
+        }
+        else if (cj < 0.61) {
+          value = transition(vs[k][ps[j]], vm[k][pm[j]], cj, 0.59, 0.61);
+        }
+        else if (cj <= 13.9) {
+          value = vm[k][pm[j]];
+        }
+        else if (cj < 14.1) {
+          value = transition(vm[k][pm[j]], gfdi_large(k, cj, tau), cj, 13.9, 14.1);
+        }
+        else {
+          value = gfdi_large(k, cj, tau);
+        }
+      }
+    }
+  }
+}
+
+
+template <bool relativistic>
+GfdiAllOrders gfdiAll(const double chi, const double tau, const bool withDerivatives) {
+  assert(tau <= 100. and "Outside of known convergence region for analytic approx.");
+  assert((relativistic or tau == 0) and "non-relativistic gfdi needs tau == 0");
+  Instrumentation::count(Instrumentation::Probe::Gfdi);
+
+  GfdiAllOrders result {{{0, 0, 0}}, {{0, 0, 0}}};
+  Orders* const dchi = withDerivatives ? &result.dchi : nullptr;
+
+  // blend two regimes as in gfdi()
+  const auto blend = [&] (void (*left)(double, double, Orders&, Orders*),
+      void (*right)(double, double, Orders&, Orders*), const double xl, const double xr) {
+    Orders fl, fr, dfl, dfr;
+    left(chi, tau, fl, withDerivatives ? &dfl : nullptr);
+    right(chi, tau, fr, withDerivatives ? &dfr : nullptr);
+    for (int k=0; k<3; ++k) {
+      result.value[k] = transition(fl[k], fr[k], chi, xl, xr);
+      if (withDerivatives)
+        result.dchi[k] = dtransition(fl[k], fr[k], dfl[k], dfr[k], chi, xl, xr);
+    }
+  };
+
+  if (chi <= 0.59) {
+    all_small<relativistic>(chi, tau, result.value, dchi);
+  }
+  else if (chi < 0.61) {
+    blend(all_small<relativistic>, all_mid<relativistic>, 0.59, 0.61);
+  }
+  else if (chi <= 13.9) {
+    all_mid<relativistic>(chi, tau, result.value, dchi);
+  }
+  else if (chi < 14.1) {
+    blend(all_mid<relativistic>, all_large<relativistic>, 13.9, 14.1);
+  }
+  else {
+    all_large<relativistic>(chi, tau, result.value, dchi);
+  }
+  return result;
+}
+
+template GfdiAllOrders gfdiAll<false>(double, double, bool);
+template GfdiAllOrders gfdiAll<true>(double, double, bool);
+
+
+GfdiAllOrders gfdiAll(const double chi, const double tau, const bool withDerivatives) {
+  return (tau == 0) ? gfdiAll<false>(chi, tau, withDerivatives)
+    : gfdiAll<true>(chi, tau, withDerivatives);
+}
+
+
+template <bool relativistic>
+double gfdiDensity(const double chi, const double tau) {
+  if (not relativistic) return gfdi<GFDI::Order12, false>(chi, tau);
+  const GfdiAllOrders i = gfdiAll<true>(chi, tau);
+  return i[GFDI::Order12] + tau*i[GFDI::Order32];
+}
+
+template double gfdiDensity<false>(double, double);
+template double gfdiDensity<true>(double, double);
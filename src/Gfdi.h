@@ -2,6 +2,9 @@
 #ifndef TFDH_GFDI_H
 #define TFDH_GFDI_H
 
+#include <array>
+#include <cstddef>
+
 
 // the int value associated with each enum item is the index used
 // in the gfdi() function for accessing the tabulated coefficients
@@ -20,5 +23,47 @@ enum class GFDI {Order12=0, Order32=1, Order52=2};
 // tau - kT/mcc
 double gfdi(GFDI order, double chi, double tau);
 
+// gfdi() specialized at compile time for one order, and for the
+// non-relativistic limit: with relativistic false, tau must be exactly 0, and
+// the factors sqrt(1 + ... tau/2) and the tau-dependent terms are left out.
+// the run-time gfdi() dispatches to these; hot loops can pick one once (see
+// PlasmaState) instead of switching on every call
+template <GFDI order, bool relativistic>
+double gfdi(double chi, double tau);
+
+// gfdi() for all three orders at one (chi, tau), indexed like the enum, and
+// optionally their derivatives d(gfdi)/d(chi) -- left as zero if not requested
+struct GfdiAllOrders {
+  std::array<double, 3> value;
+  std::array<double, 3> dchi;
+  double operator[](GFDI order) const {return value[static_cast<int>(order)];}
+};
+
+// Fused evaluation of all three orders, sharing the exponentials and square
+// roots between them (they depend on chi and tau but not on the order), so it
+// costs about as much as a single call to gfdi().
+GfdiAllOrders gfdiAll(double chi, double tau, bool withDerivatives=false);
+
+// gfdiAll() specialized like gfdi<order, relativistic>
+template <bool relativistic>
+GfdiAllOrders gfdiAll(double chi, double tau, bool withDerivatives=false);
+
+// I_1/2 + tau I_3/2, the combination making up the electron density: a
+// single order in the non-relativistic limit
+template <bool relativistic>
+double gfdiDensity(double chi, double tau);
+
+// Batch versions of gfdi() over n values of chi at one tau:
+//   result[j] = gfdi(order, chi[j], tau)
+// The five-term sums of the "small" and "mid" regimes are evaluated as
+// branch-free loops over the points, which the compiler vectorizes (AVX2 or
+// AVX-512 under -march=native), and the exponentials and square roots that
+// don't depend on the order are shared when several orders are requested.
+void gfdi(GFDI order, const double* chi, size_t n, double tau, double* result);
+
+// as above, for all three orders at once -- null outputs are skipped
+void gfdi(const double* chi, size_t n, double tau,
+    double* i12, double* i32, double* i52);
+
 
 #endif // TFDH_GFDI_H
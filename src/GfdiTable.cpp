@@ -0,0 +1,275 @@
+#include "GfdiTable.h"
+
+#include "Gfdi.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+
+constexpr double GfdiTable::chiMin;
+constexpr double GfdiTable::chiMax;
+constexpr double GfdiTable::tauMin;
+constexpr double GfdiTable::tauMax;
+
+
+namespace {
+
+  // the uniform pieces of the chi axis below octave_chi_lo, split where gfdi()
+  // blends its regimes
+  struct Piece {
+    double chiLo;
+    double chiHi;
+    size_t numCells;
+  };
+  const auto pieces = std::array<Piece, 5> {{
+    {GfdiTable::chiMin, 0.59, 2048}, {0.59, 0.61, 16}, {0.61, 13.9, 512},
+    {13.9, 14.1, 16}, {14.1, 16.0, 64}}};
+
+  // above it, cells_per_octave cells in each [2^(e-1), 2^e) up to chiMax
+  const double octave_chi_lo = 16.0;
+  const int first_octave = 5;
+  const int last_octave = 30;
+  const size_t cells_per_octave = 64;
+
+  // the tau nodes, uniform in ln tau
+  const size_t num_tau_cells = 512;
+
+  // what the lookup needs of each piece
+  struct PieceLookup {
+    double chiLo;
+    double invWidth;
+    size_t firstCell;
+    size_t numCells;
+  };
+  std::array<PieceLookup, pieces.size()> makePieceLookups() {
+    std::array<PieceLookup, pieces.size()> lookups;
+    size_t firstCell = 0;
+    for (size_t p=0; p<pieces.size(); ++p) {
+      const Piece& piece = pieces[p];
+      lookups[p] = {piece.chiLo, piece.numCells/(piece.chiHi - piece.chiLo), firstCell, piece.numCells};
+      firstCell += piece.numCells;
+    }
+    return lookups;
+  }
+  const std::array<PieceLookup, pieces.size()> piece_lookups = makePieceLookups();
+  const size_t octaves_first_cell = piece_lookups.back().firstCell + piece_lookups.back().numCells;
+
+  // ln(I_1/2 + tau I_3/2) and its derivative in chi
+  std::array<double, 2> lnDensity(const double chi, const double tau) {
+    const GfdiAllOrders i = gfdiAll<true>(chi, tau, true);
+    const double density = i[GFDI::Order12] + tau*i[GFDI::Order32];
+    const double dchi = i.dchi[static_cast<int>(GFDI::Order12)] + tau*i.dchi[static_cast<int>(GFDI::Order32)];
+    return {{log(density), dchi/density}};
+  }
+
+  // weights of the cubic through nodes at 0,1,2,3, evaluated at t
+  inline void lagrangeWeights(const double t, double w[4]) {
+    const double t0 = t, t1 = t-1, t2 = t-2, t3 = t-3;
+    w[0] = -t1*t2*t3/6;
+    w[1] = t0*t2*t3/2;
+    w[2] = -t0*t1*t3/2;
+    w[3] = t0*t1*t2/6;
+  }
+
+  // the process-wide grid: the chi nodes, and at each tau node computed so far
+  // ln(density) and its derivative in chi at every chi node
+  class Grid {
+   public:
+    Grid();
+
+    // ln(density) and its derivative at the chi nodes, interpolated to tau
+    std::vector<double> slice(double tau);
+
+    std::vector<double> chis;
+
+   private:
+    const double lnTauLo;
+    const double dlnTau;
+    std::mutex mutex;
+    std::vector<std::vector<double>> atTauNodes;
+
+    // computed on first use; never changed after, so safe to read unlocked
+    const std::vector<double>& atTauNode(size_t k);
+  };
+
+  Grid::Grid()
+  : lnTauLo(log(GfdiTable::tauMin)),
+    dlnTau((log(GfdiTable::tauMax) - lnTauLo) / num_tau_cells),
+    atTauNodes(num_tau_cells + 1)
+  {
+    for (const Piece& piece : pieces) {
+      for (size_t i=0; i<piece.numCells; ++i) {
+        chis.push_back(piece.chiLo + i*(piece.chiHi - piece.chiLo)/piece.numCells);
+      }
+    }
+    for (int e=first_octave; e<=last_octave; ++e) {
+      for (size_t i=0; i<cells_per_octave; ++i) {
+        chis.push_back(ldexp(1.0 + static_cast<double>(i)/cells_per_octave, e-1));
+      }
+    }
+    chis.push_back(GfdiTable::chiMax);
+  }
+
+  const std::vector<double>& Grid::atTauNode(const size_t k)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<double>& values = atTauNodes[k];
+    if (values.empty()) {
+      const double tau = exp(lnTauLo + k*dlnTau);
+      values.reserve(2*chis.size());
+      for (const double chi : chis) {
+        const std::array<double, 2> f = lnDensity(chi, tau);
+        values.push_back(f[0]);
+        values.push_back(f[1]);
+      }
+    }
+    return values;
+  }
+
+  std::vector<double> Grid::slice(const double tau)
+  {
+    const double u = (log(tau) - lnTauLo) / dlnTau;
+    const double first = std::min(std::max(floor(u) - 1, 0.0), static_cast<double>(num_tau_cells - 3));
+    const size_t k = static_cast<size_t>(first);
+    double w[4];
+    lagrangeWeights(u - first, w);
+
+    const double* f[4];
+    for (size_t j=0; j<4; ++j) f[j] = atTauNode(k+j).data();
+    std::vector<double> result(2*chis.size());
+    for (size_t i=0; i<result.size(); ++i) {
+      result[i] = w[0]*f[0][i] + w[1]*f[1][i] + w[2]*f[2][i] + w[3]*f[3][i];
+    }
+    return result;
+  }
+
+  Grid& grid() {
+    static Grid g;
+    return g;
+  }
+
+  // the cubic Hermite interpolant of each cell at tau, from the density and its
+  // derivative at both ends, as coefficients in t
+  std::vector<double> cubicsAt(const double tau) {
+    const std::vector<double>& chis = grid().chis;
+    const std::vector<double> nodes = grid().slice(tau);
+    std::vector<double> cubics(4*(chis.size() - 1));
+    double f0 = exp(nodes[0]);
+    double d0 = f0*nodes[1];
+    for (size_t i=0; i+1<chis.size(); ++i) {
+      const double f1 = exp(nodes[2*i+2]);
+      const double d1 = f1*nodes[2*i+3];
+      const double width = chis[i+1] - chis[i];
+      const double m0 = width*d0;
+      const double m1 = width*d1;
+      double* c = &cubics[4*i];
+      c[0] = f0;
+      c[1] = m0;
+      c[2] = 3*(f1 - f0) - 2*m0 - m1;
+      c[3] = 2*(f0 - f1) + m0 + m1;
+      f0 = f1;
+      d0 = d1;
+    }
+    return cubics;
+  }
+
+  // cubicsAt(tau), shared between all callers asking for the same tau while
+  // any of them holds on to it
+  std::shared_ptr<const std::vector<double>> sharedCubicsAt(const double tau) {
+    using Cubics = std::vector<double>;
+    static std::mutex mutex;
+    static std::map<double, std::weak_ptr<const Cubics>> slices;
+    // the most recently built slices are kept alive even when unused, so that
+    // a sequence of short-lived PlasmaStates at one tau doesn't rebuild them
+    static std::deque<std::shared_ptr<const Cubics>> recent;
+    const size_t numRecent = 16;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      const std::shared_ptr<const Cubics> slice = slices[tau].lock();
+      if (slice) return slice;
+    }
+
+    // built without holding the lock, so that other threads can look up their
+    // slices meanwhile; if another thread built this one too, the first wins
+    const std::shared_ptr<const Cubics> built = std::make_shared<const Cubics>(cubicsAt(tau));
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::shared_ptr<const Cubics> slice = slices[tau].lock();
+    if (slice) return slice;
+    // forget about slices nobody uses anymore before adding a new one
+    for (auto it=slices.begin(); it!=slices.end(); ) {
+      it = it->second.expired() ? slices.erase(it) : std::next(it);
+    }
+    slices[tau] = built;
+    recent.push_back(built);
+    if (recent.size() > numRecent) recent.pop_front();
+    return built;
+  }
+
+} // helper namespace
+
+
+
+GfdiTable::GfdiTable(const double tau, const double chi0)
+: tau(tau),
+  inRange(tau >= tauMin and tau <= tauMax),
+  cubics(inRange ? sharedCubicsAt(tau) : nullptr),
+  scale(1.0)
+{
+  // (1 if chi0 is outside of the table, where density() is gfdi() already)
+  scale = gfdiDensity<true>(chi0, tau) / density(chi0);
+}
+
+
+const double* GfdiTable::cell(const double chi, double& t, double& invWidth) const
+{
+  size_t first, numCells;
+  double u;
+  if (chi >= octave_chi_lo) {
+    // chi = m 2^e with m in [0.5, 1)
+    int e;
+    const double m = frexp(chi, &e);
+    u = (2*m - 1) * cells_per_octave;
+    first = octaves_first_cell + (e - first_octave)*cells_per_octave;
+    numCells = cells_per_octave;
+    invWidth = ldexp(static_cast<double>(cells_per_octave), 1-e);
+  } else {
+    size_t p = pieces.size() - 1;
+    while (chi < piece_lookups[p].chiLo) --p;
+    const PieceLookup& piece = piece_lookups[p];
+    u = (chi - piece.chiLo) * piece.invWidth;
+    first = piece.firstCell;
+    numCells = piece.numCells;
+    invWidth = piece.invWidth;
+  }
+  // (u can round up to numCells at the top of a piece)
+  const size_t inPiece = std::min(static_cast<size_t>(u), numCells - 1);
+  t = u - inPiece;
+  return &(*cubics)[4*(first + inPiece)];
+}
+
+
+double GfdiTable::density(const double chi) const
+{
+  if (not (inRange and chi >= chiMin and chi < chiMax)) return gfdiDensity<true>(chi, tau);
+  double t, invWidth;
+  const double* c = cell(chi, t, invWidth);
+  return scale * (c[0] + t*(c[1] + t*(c[2] + t*c[3])));
+}
+
+
+double GfdiTable::dDensityDchi(const double chi) const
+{
+  if (not (inRange and chi >= chiMin and chi < chiMax)) {
+    const GfdiAllOrders i = gfdiAll<true>(chi, tau, true);
+    return i.dchi[static_cast<int>(GFDI::Order12)] + tau*i.dchi[static_cast<int>(GFDI::Order32)];
+  }
+  double t, invWidth;
+  const double* c = cell(chi, t, invWidth);
+  return scale * (c[1] + t*(2*c[2] + 3*t*c[3])) * invWidth;
+}
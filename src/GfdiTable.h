@@ -0,0 +1,56 @@
+#ifndef TFDH_GFDI_TABLE_H
+#define TFDH_GFDI_TABLE_H
+
+#include <memory>
+#include <vector>
+
+
+// Tabulated I_1/2 + tau I_3/2 -- the electron density, see gfdiDensity() --
+// and its derivative in chi, for the relativistic states: there gfdi() is at
+// its most expensive, with a factor sqrt(1 + ... tau/2) in every term of its
+// sums, and these two are what the ODE right-hand side evaluates at every
+// point. (At tau == 0 the specialized gfdi() is about as cheap as a lookup.)
+//
+// One grid per process, in chi and ln tau, holds ln(I_1/2 + tau I_3/2) and its
+// derivative in chi at the nodes; the tau nodes are computed when first needed,
+// so a run only pays for the temperatures it visits. A GfdiTable uses the slice
+// of it at one tau, interpolated in ln tau (4-point Lagrange) and stored as one
+// cubic per cell in chi (Hermite), so a lookup is a polynomial evaluation,
+// without exp() or log().
+//
+// The chi axis is uniform below 16, in pieces split at the edges of gfdi()'s
+// blending regions (0.59, 0.61, 13.9, 14.1) where it is only C1, and has a
+// fixed number of cells per octave above. Against gfdi(), the density is
+// accurate to a few 1e-9 relative and its derivative to ~2e-7. Outside of
+// [chiMin, chiMax) x [tauMin, tauMax] the analytic gfdi() is used.
+//
+// The slices are shared by all tables at one tau, while any of them is alive.
+// Each table is also scaled to match gfdiDensity() exactly at chi0, the
+// plasma's own chi: the TFDH equations subtract the background density, and
+// even a 1e-9 error there, integrated over the ion sphere, shifts the energies.
+class GfdiTable {
+ public:
+  GfdiTable(double tau, double chi0);
+
+  double density(double chi) const;
+  double dDensityDchi(double chi) const;
+
+  const double tau;
+
+  static constexpr double chiMin = -60.0;
+  static constexpr double chiMax = 1073741824.0; // 2^30
+  static constexpr double tauMin = 1e-5;
+  static constexpr double tauMax = 10.0;
+
+ private:
+  const bool inRange;
+  // 4 coefficients in t per cell, t in [0,1), of the slice at tau
+  const std::shared_ptr<const std::vector<double>> cubics;
+  double scale;
+
+  // the coefficients of the cell holding chi, and where chi is in it
+  const double* cell(double chi, double& t, double& invWidth) const;
+};
+
+
+#endif // TFDH_GFDI_TABLE_H
@@ -0,0 +1,212 @@
+#include "GridSweep.h"
+
+#include "Composition.h"
+#include "Element.h"
+#include "ParallelFor.h"
+#include "PhysicalConstants.h"
+#include "PlasmaState.h"
+#include "TfdhBvpSolve.h"
+#include "TfdhIon.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+  // estimate of dv0 at path[i] from the solutions at the previous points:
+  // linear extrapolation in the distance along the path in (ln rho, ln T),
+  // of ln(-dv0) as long as dv0 stays negative (it scales with the plasma
+  // parameters much like a power law). 0, i.e. no guess, at the first point
+  double extrapolateDv0(const std::vector<Sweep::PathPoint>& path,
+      const std::vector<double>& dv0s, const size_t i) {
+    if (i == 0) return 0.0;
+    if (i == 1) return dv0s[0];
+    const auto distance = [&] (const size_t a, const size_t b) {
+      return hypot(log(path[a].rho/path[b].rho), log(path[a].t/path[b].t));
+    };
+    const double d_prev = distance(i-1, i-2);
+    if (d_prev == 0) return dv0s[i-1];
+    const double frac = distance(i, i-1) / d_prev;
+    const double v1 = dv0s[i-2], v2 = dv0s[i-1];
+    if (v1 < 0 and v2 < 0) {
+      return -exp(log(-v2) + frac*(log(-v2) - log(-v1)));
+    }
+    return v2 + frac*(v2 - v1);
+  }
+
+} // helper namespace
+
+
+
+void Sweep::solvePath(const std::vector<PathPoint>& path, const Composition& comp,
+    const Element& traceIon, const bool isRelativistic, const bool tabulateGfdi,
+    const TFDH::Method method, const std::function<void(size_t, const TfdhIon&)>& visit)
+{
+  std::vector<double> rhos, kts;
+  for (const PathPoint& point : path) {
+    rhos.push_back(point.rho);
+    kts.push_back(point.t * PhysicalConstantsCGS::KBoltzmann);
+  }
+  const std::vector<PlasmaState> states =
+    PlasmaState::batch(rhos, kts, comp, isRelativistic, tabulateGfdi);
+
+  std::vector<double> dv0s;
+  for (size_t i=0; i<path.size(); ++i) {
+    const TfdhIon ion(states[i], traceIon, extrapolateDv0(path, dv0s, i), method);
+    dv0s.push_back(ion.tfdh.dv0);
+    visit(i, ion);
+  }
+}
+
+
+size_t Sweep::Grid::size() const
+{
+  return rhos.size() * temperatures.size() * compositions.size() * traceIons.size();
+}
+
+
+std::vector<double> Sweep::logRange(const double lo, const double hi, const size_t n)
+{
+  assert(lo > 0 and hi > 0 and n > 0);
+  if (n==1) return {lo};
+  std::vector<double> values(n);
+  const double dlog = log(hi/lo) / (n-1);
+  for (size_t i=0; i<n; ++i) {
+    values[i] = lo * exp(i*dlog);
+  }
+  values.back() = hi; // avoid roundoff in the endpoint
+  return values;
+}
+
+
+std::vector<Sweep::Row> Sweep::run(const Grid& grid, const unsigned numThreads)
+{
+  const size_t nion = grid.traceIons.size();
+  const size_t ncomp = grid.compositions.size();
+  const size_t nt = grid.temperatures.size();
+
+  std::vector<Row> rows(grid.size());
+  if (rows.empty()) return rows;
+  const size_t numPaths = rows.size() / nt;
+
+  // with fewer paths than threads -- e.g. a sweep over temperature alone --
+  // the paths are cut into chunks, each warm-started from its own first
+  // point, so that every thread has work
+  const unsigned threads = (numThreads == 0) ? defaultThreadCount() : numThreads;
+  const size_t chunksWanted = std::min(nt, (threads + numPaths - 1) / numPaths);
+  const size_t chunkLength = (nt + chunksWanted - 1) / chunksWanted;
+  const size_t chunksPerPath = (nt + chunkLength - 1) / chunkLength;
+
+  const auto solveAlongT = [&] (const size_t task) {
+    const size_t path = task / chunksPerPath;
+    const size_t first = (task % chunksPerPath) * chunkLength;
+    const size_t ion = path % nion;
+    const size_t composition = (path / nion) % ncomp;
+    const size_t rho = path / (nion*ncomp);
+
+    std::vector<PathPoint> points;
+    for (size_t t=first; t<std::min(nt, first+chunkLength); ++t) {
+      points.push_back({grid.rhos[rho], grid.temperatures[t]});
+    }
+
+    const auto store = [&] (const size_t i, const TfdhIon& tfdhIon) {
+      const size_t t = first + i;
+      Row& row = rows[((rho*nt + t)*ncomp + composition)*nion + ion];
+      row.rho = rho;
+      row.t = t;
+      row.composition = composition;
+      row.ion = ion;
+      row.ne = tfdhIon.ps.ne;
+      row.chi = tfdhIon.ps.chi;
+      row.numberBoundElectrons = tfdhIon.numberBoundElectrons;
+      row.embeddingEnergy = tfdhIon.embeddingEnergies.total / tfdhIon.ps.kt;
+      row.cost = tfdhIon.cost;
+    };
+    solvePath(points, grid.compositions[composition], grid.traceIons[ion],
+        grid.isRelativistic, grid.tabulateGfdi, grid.method, store);
+  };
+  parallelFor(numPaths * chunksPerPath, solveAlongT, threads);
+
+  return rows;
+}
+
+
+void Sweep::printRowsToFile(const std::string& filename, const Grid& grid,
+    const std::vector<Row>& rows, const std::string& time)
+{
+  std::ofstream outfile(filename);
+  assert(outfile and "couldn't open file");
+  outfile.precision(10);
+
+  outfile << "# grid sweep of TFDH ion-in-plasma calculation results\n";
+  outfile << "# code run on " << time << "\n";
+  outfile << "#\n";
+  for (size_t c=0; c<grid.compositions.size(); ++c)
+    outfile << "# composition #" << c << " = " << grid.compositions[c] << "\n";
+  outfile << "#\n";
+  outfile << "# col #0 = rho\n";
+  outfile << "# col #1 = t\n";
+  outfile << "# col #2 = composition index\n";
+  outfile << "# col #3 = central ion Z\n";
+  outfile << "# col #4 = central ion A\n";
+  outfile << "# col #5 = ne\n";
+  outfile << "# col #6 = chi\n";
+  outfile << "# col #7 = number of bound electrons\n";
+  outfile << "# col #8 = Z_net\n";
+  outfile << "# col #9 = embedding energy [kT]\n";
+
+  const std::string sep = "    ";
+  for (const Row& row : rows) {
+    const Element& e = grid.traceIons[row.ion];
+    outfile << grid.rhos[row.rho] << sep << grid.temperatures[row.t]
+      << sep << row.composition << sep << e.Z << sep << e.A
+      << sep << row.ne << sep << row.chi
+      << sep << row.numberBoundElectrons << sep << e.Z - row.numberBoundElectrons
+      << sep << row.embeddingEnergy << "\n";
+  }
+
+  return;
+}
+
+
+void Sweep::printStatsToFile(const std::string& filename, const Grid& grid,
+    const std::vector<Row>& rows, const std::string& time)
+{
+  std::ofstream outfile(filename);
+  assert(outfile and "couldn't open file");
+  outfile.precision(10);
+
+  outfile << "# cost of each grid point of a sweep of the TFDH ion-in-plasma calculation\n";
+  outfile << "# code run on " << time << "\n";
+  if (not Instrumentation::enabled)
+    outfile << "# NOTE: built without instrumentation, all counts are 0; see Instrumentation.h\n";
+  outfile << "# times are inclusive, in ns; points read from the cache cost 0\n";
+  outfile << "#\n";
+  outfile << "# col #0 = rho\n";
+  outfile << "# col #1 = t\n";
+  outfile << "# col #2 = composition index\n";
+  outfile << "# col #3 = central ion Z\n";
+  outfile << "# col #4 = central ion A\n";
+  for (size_t i=0; i<Instrumentation::num_probes; ++i) {
+    outfile << "# col #" << 5+2*i << " = calls of " << Instrumentation::names[i] << "\n";
+    outfile << "# col #" << 6+2*i << " = time in " << Instrumentation::names[i] << "\n";
+  }
+
+  const std::string sep = "    ";
+  for (const Row& row : rows) {
+    const Element& e = grid.traceIons[row.ion];
+    outfile << grid.rhos[row.rho] << sep << grid.temperatures[row.t]
+      << sep << row.composition << sep << e.Z << sep << e.A;
+    for (size_t i=0; i<Instrumentation::num_probes; ++i)
+      outfile << sep << row.cost.calls[i] << sep << row.cost.ns[i];
+    outfile << "\n";
+  }
+
+  return;
+}
@@ -0,0 +1,84 @@
+#ifndef TFDH_GRID_SWEEP_H
+#define TFDH_GRID_SWEEP_H
+
+#include "Composition.h"
+#include "Element.h"
+#include "Instrumentation.h"
+#include "TfdhBvpSolve.h"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+class TfdhIon;
+
+
+namespace Sweep {
+
+  // the axes of a grid sweep -- every combination of one value from each axis
+  // is one grid point, i.e. one TfdhIon to solve
+  struct Grid {
+    std::vector<double> rhos;
+    std::vector<double> temperatures; // in kelvin
+    std::vector<Composition> compositions;
+    std::vector<Element> traceIons;
+    bool isRelativistic;
+    bool tabulateGfdi; // see PlasmaState
+    TFDH::Method method; // see TfdhIon
+
+    size_t size() const;
+  };
+
+  // results at one grid point, i.e. one row of the output table
+  struct Row {
+    // indices into the axes of the Grid
+    size_t rho;
+    size_t t;
+    size_t composition;
+    size_t ion;
+
+    double ne;
+    double chi;
+    double numberBoundElectrons;
+    double embeddingEnergy; // in units of kT
+
+    Instrumentation::Counts cost; // see TfdhIon
+  };
+
+  // a point on a path through the (rho,T) plane
+  struct PathPoint {
+    double rho;
+    double t; // in kelvin
+  };
+
+  // solve the trace ion at each point of a path in turn, warm-starting the
+  // shooting at each point from the dv0 extrapolated (in log rho and log T)
+  // from the previous points. visit(i, ion) is called with the solution at
+  // path[i], in path order; the TfdhIon doesn't outlive the call
+  void solvePath(const std::vector<PathPoint>& path, const Composition& comp,
+      const Element& traceIon, bool isRelativistic, bool tabulateGfdi, TFDH::Method method,
+      const std::function<void(size_t, const TfdhIon&)>& visit);
+
+  // n values spaced evenly in log between lo and hi (inclusive)
+  std::vector<double> logRange(double lo, double hi, size_t n);
+
+  // solve every grid point on numThreads threads (0 => one per core)
+  // each thread solves paths along the temperature axis with solvePath():
+  // whole paths, or if there are fewer paths than threads, chunks of them
+  // of about equal length. rows are returned in grid order, with the trace ion varying
+  // fastest and rho slowest, regardless of the order in which they were solved
+  std::vector<Row> run(const Grid& grid, unsigned numThreads=0);
+
+  void printRowsToFile(const std::string& filename, const Grid& grid,
+      const std::vector<Row>& rows, const std::string& time="<no time given>");
+
+  // the cost of each grid point (see Instrumentation.h), one row per point in
+  // the order of printRowsToFile: calls and time of each probe
+  void printStatsToFile(const std::string& filename, const Grid& grid,
+      const std::vector<Row>& rows, const std::string& time="<no time given>");
+
+}
+
+
+#endif // TFDH_GRID_SWEEP_H
@@ -1,6 +1,9 @@
 
 #include "GslWrappers.h"
 
+#include "Instrumentation.h"
+#include "ObjectPool.h"
+
 #include <cassert>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_integration.h>
@@ -20,32 +23,21 @@ namespace {
     const GSL::FunctionObject* func = static_cast<const GSL::FunctionObject*>(params);
     return (*func)(x);
   }
-}
-
 
-GSL::Spline::Spline(const std::vector<double>& x, const std::vector<double>& f)
-: acc(gsl_interp_accel_alloc()),
-  spline(gsl_spline_alloc(gsl_interp_cspline, x.size()))
-{
-  assert(x.size()==f.size());
-  gsl_spline_init(spline, x.data(), f.data(), x.size());
-}
-
-GSL::Spline::~Spline()
-{
-  gsl_spline_free(spline);
-  gsl_interp_accel_free(acc);
-}
+  // NOTE: this choice has worked so far, but could be increased if necessary
+  const size_t max_intervals = 100;
 
-double GSL::Spline::eval(const double r) const
-{
-  return gsl_spline_eval(spline, r, acc);
+  // each thread recycles its own solvers and workspaces, see ObjectPool.h
+  thread_local ObjectPool<gsl_root_fsolver, gsl_root_fsolver_free> rootSolvers;
+  thread_local ObjectPool<gsl_integration_workspace, gsl_integration_workspace_free> integrationWorkspaces;
 }
 
 
 double GSL::findRoot(const GSL::FunctionObject& func, const double xa, const double xb,
     const double eps_abs, const double eps_rel)
 {
+  const Instrumentation::ScopedTimer timer(Instrumentation::Probe::FindRoot);
+
   // check that interval brackets the root
   assert(func(xa)*func(xb) <= 0);
   if (xa==xb) return xa;
@@ -55,8 +47,9 @@ double GSL::findRoot(const GSL::FunctionObject& func, const double xa, const dou
   f.params = const_cast<GSL::FunctionObject*>(&func);
   f.function = &callFunctionFromObject;
 
-  gsl_root_fsolver* solver = gsl_root_fsolver_alloc(gsl_root_fsolver_brent);
-  gsl_root_fsolver_set(solver, &f, fmin(xa,xb), fmax(xa,xb));
+  const auto handle = rootSolvers.acquire([] { return gsl_root_fsolver_alloc(gsl_root_fsolver_brent); });
+  gsl_root_fsolver* solver = handle.get();
+  gsl_root_fsolver_set(solver, &f, fmin(xa,xb), fmax(xa,xb)); // (resets the solver)
 
   // iterate
   const int max_iter = 80;
@@ -69,31 +62,29 @@ double GSL::findRoot(const GSL::FunctionObject& func, const double xa, const dou
   }
   assert(status==GSL_SUCCESS);
 
-  const double result = gsl_root_fsolver_root(solver);
-  gsl_root_fsolver_free(solver);
-  return result;
+  return gsl_root_fsolver_root(solver);
 }
 
 
 double GSL::integrate(const GSL::FunctionObject& func, const double xi, const double xf,
     const double eps_abs, const double eps_rel)
 {
+  const Instrumentation::ScopedTimer timer(Instrumentation::Probe::Integrate);
+
   // set up integrator
   gsl_function f;
   f.params = const_cast<GSL::FunctionObject*>(&func);
   f.function = &callFunctionFromObject;
 
-  // NOTE: this choice has worked so far, but could be increased if necessary
-  const size_t max_intervals = 100;
-  gsl_integration_workspace* ws = gsl_integration_workspace_alloc(max_intervals);
+  // (qag initializes the workspace itself)
+  const auto handle = integrationWorkspaces.acquire([] { return gsl_integration_workspace_alloc(max_intervals); });
+  gsl_integration_workspace* ws = handle.get();
 
   double result = 0.0;
   double abs_err = 0.0;
   gsl_integration_qag(&f, xi, xf, eps_abs, eps_rel,
       max_intervals, GSL_INTEG_GAUSS21, ws,
       &result, &abs_err);
-
-  gsl_integration_workspace_free(ws);
   return result;
 }
 
@@ -2,9 +2,6 @@
 #ifndef TFDH_GSL_WRAPPERS_H
 #define TFDH_GSL_WRAPPERS_H
 
-#include <gsl/gsl_spline.h>
-#include <vector>
-
 
 namespace GSL {
 
@@ -13,26 +10,30 @@ namespace GSL {
   // parameters as member variables, and operator()(double x) should evaluate
   // the function f(x).
   //
-  // NOTE: the GSL wrappers below could in principle take C++11 lambdas instead
-  //       of this custom function object, however i did not find an elegant
-  //       way to call these lambdas using GSL's C interfaces...
+  // NOTE: the project's solvers now take lambdas directly, see
+  //       NativeSolvers.h; the GSL wrappers below remain as the reference
+  //       implementation, and take a lambda through Callable
   class FunctionObject {
     public:
       virtual ~FunctionObject() = default;
       virtual double operator()(double x) const = 0;
   };
 
-  // simple wrapper class around GSL splines
-  class Spline {
+  // a FunctionObject calling any callable f, e.g. a lambda:
+  //   GSL::findRoot(GSL::callable(f), ...) is the reference for
+  //   Native::findRoot(f, ...)
+  template <typename F>
+  class Callable : public FunctionObject {
     private:
-      gsl_interp_accel* acc;
-      gsl_spline* spline;
+      const F& f;
     public:
-      Spline(const std::vector<double>& x, const std::vector<double>& f);
-      ~Spline();
-      double eval(double r) const;
+      explicit Callable(const F& f) : f(f) {}
+      double operator()(const double x) const override {return f(x);}
   };
 
+  template <typename F>
+  Callable<F> callable(const F& f) {return Callable<F>(f);}
+
   // find a root of func in the interval x1 to x2
   // one of (x1,x2) or (x2,x1) MUST bracket a root
   // implemented using GSL's Brent rootfinder method
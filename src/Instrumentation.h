@@ -0,0 +1,155 @@
+#ifndef TFDH_INSTRUMENTATION_H
+#define TFDH_INSTRUMENTATION_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+
+// counters and timers on the hot functions, to see where the time of a
+// TfdhIon goes. they are compiled in only when TFDH_INSTRUMENT is defined
+// (make INSTRUMENT=1); otherwise every probe is empty and all counts read 0.
+//
+// each thread keeps its own totals, so a probe is a plain add with no
+// locking. parallelFor adds the totals of its worker threads to those of the
+// calling thread once they are done, so the cost of a multisection solve
+// lands on the thread that asked for it. times are inclusive: the time in
+// integrateODE includes that of the tfdhOdeRhs calls it makes, and so on.
+// gfdi is too cheap to time (a clock read costs as much), so it's only
+// counted; tfdhOdeRhs is timed on a sample of its calls, see SampledTimer
+namespace Instrumentation {
+
+#ifdef TFDH_INSTRUMENT
+  const bool enabled = true;
+#else
+  const bool enabled = false;
+#endif
+
+  // "integrate" and "findRoot" count both the GSL:: and the Native:: versions
+  enum class Probe {TfdhIon, FindPotentialRoot, IntegrateOde, OdeRhs, Integrate, FindRoot, Gfdi};
+  const size_t num_probes = 7;
+  const char* const names[num_probes] = {
+    "TfdhIon", "findPotentialRoot", "integrateODE", "tfdhOdeRhs", "integrate", "findRoot", "gfdi"};
+
+  // zero-initialized by Counts c = {}
+  struct Counts {
+    std::array<uint64_t, num_probes> calls;
+    std::array<uint64_t, num_probes> ns;
+
+    Counts& operator+=(const Counts& other) {
+      for (size_t i=0; i<num_probes; ++i) {
+        calls[i] += other.calls[i];
+        ns[i] += other.ns[i];
+      }
+      return *this;
+    }
+    Counts operator-(const Counts& other) const {
+      Counts diff = *this;
+      for (size_t i=0; i<num_probes; ++i) {
+        diff.calls[i] -= other.calls[i];
+        diff.ns[i] -= other.ns[i];
+      }
+      return diff;
+    }
+  };
+
+  typedef std::chrono::steady_clock Clock;
+
+  inline uint64_t nanosecondsSince(const Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+  }
+
+#ifdef TFDH_INSTRUMENT
+  inline Counts& threadTotals() {
+    static thread_local Counts totals = {};
+    return totals;
+  }
+
+  // the totals of the calling thread, since it started
+  inline Counts snapshot() { return threadTotals(); }
+  // adds counts from elsewhere (another thread) to the calling thread's
+  inline void addToThread(const Counts& counts) { threadTotals() += counts; }
+  // count n calls of an untimed probe
+  inline void count(const Probe probe, const uint64_t n=1) {
+    threadTotals().calls[static_cast<size_t>(probe)] += n;
+  }
+#else
+  inline Counts snapshot() { return {}; }
+  inline void addToThread(const Counts&) {}
+  inline void count(Probe, uint64_t=1) {}
+#endif
+
+  // counts and times one call: from construction to the end of the scope
+  class ScopedTimer {
+   public:
+#ifdef TFDH_INSTRUMENT
+    explicit ScopedTimer(const Probe p) : probe(static_cast<size_t>(p)), start(Clock::now()) {}
+    ~ScopedTimer() {
+      Counts& totals = threadTotals();
+      totals.calls[probe] += 1;
+      totals.ns[probe] += nanosecondsSince(start);
+    }
+   private:
+    const size_t probe;
+    const Clock::time_point start;
+#else
+    explicit ScopedTimer(Probe) {}
+#endif
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+  };
+
+  // as ScopedTimer, but for calls too short to time each one: every call is
+  // counted, and one in every sample_period is timed, standing in for the
+  // sample_period - 1 before it
+  class SampledTimer {
+   public:
+#ifdef TFDH_INSTRUMENT
+    static const uint64_t sample_period = 16;
+
+    explicit SampledTimer(const Probe p)
+    : probe(static_cast<size_t>(p)),
+      timed(++threadTotals().calls[probe] % sample_period == 0),
+      start(timed ? Clock::now() : Clock::time_point()) {}
+    ~SampledTimer() {
+      if (timed) threadTotals().ns[probe] += sample_period * nanosecondsSince(start);
+    }
+   private:
+    const size_t probe;
+    const bool timed;
+    const Clock::time_point start;
+#else
+    explicit SampledTimer(Probe) {}
+#endif
+    SampledTimer(const SampledTimer&) = delete;
+    SampledTimer& operator=(const SampledTimer&) = delete;
+  };
+
+  // the cost of a stretch of code run on the calling thread: the probes hit
+  // from construction to finish(), plus the stretch itself as one call of
+  // the given probe (which finish() also adds to the thread's totals)
+  class Region {
+   public:
+#ifdef TFDH_INSTRUMENT
+    explicit Region(const Probe p) : probe(static_cast<size_t>(p)), before(threadTotals()), start(Clock::now()) {}
+    Counts finish() const {
+      Counts& totals = threadTotals();
+      totals.calls[probe] += 1;
+      totals.ns[probe] += nanosecondsSince(start);
+      return totals - before;
+    }
+   private:
+    size_t probe;
+    Counts before;
+    Clock::time_point start;
+#else
+    explicit Region(Probe) {}
+    Counts finish() const { return {}; }
+#endif
+  };
+
+}
+
+
+#endif // TFDH_INSTRUMENTATION_H
@@ -2,27 +2,217 @@
 #ifndef TFDH_INTEGRATE_OVER_RADIUS_H
 #define TFDH_INTEGRATE_OVER_RADIUS_H
 
-#include "GslWrappers.h"
+#include "NativeSolvers.h"
 
+#include <array>
 #include <cmath>
+#include <cstddef>
+#include <queue>
+#include <utility>
 #include <vector>
 
 
 template <typename T>
 double integrateOverRadius(const T& func, const double rmin, const double rmax)
 {
-  class MultiplyByJacobian : public GSL::FunctionObject {
-    private:
-      const T& f;
-    public:
-      MultiplyByJacobian(const T& func) : f(func) {}
-      double operator()(const double r) const override {return 4*M_PI*r*r*f(r);};
-  };
-  const auto integrand = MultiplyByJacobian(func);
+  const auto integrand = [&] (const double r) {return 4*M_PI*r*r*func(r);};
   const double eps = 1.e-6;
   const double eps_abs = eps * (rmax-rmin) * (fabs(integrand(rmax))+fabs(integrand(rmin))) / 2;
   const double eps_rel = eps;
-  return GSL::integrate(integrand, rmin, rmax, eps_abs, eps_rel);
+  return Native::integrate(integrand, rmin, rmax, eps_abs, eps_rel);
+}
+
+
+
+// the 15-point Gauss-Kronrod rule on [-1,1] with its embedded 7-point Gauss
+// rule: nodes +-nodes[j], the last one being the center; the Gauss nodes are
+// the odd-numbered ones
+namespace GaussKronrod15 {
+  const double nodes[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+  const double kronrodWeights[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+  const double gaussWeights[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+}
+
+
+// the 15-point Gauss-Kronrod estimate of the integral of 4 pi r^2 func(r)
+// from rmin to rmax, for each of the N components of func, with the error
+// estimated as in QUADPACK (and GSL's qk15): from the difference with the
+// embedded Gauss rule, scaled for smooth integrands, and no smaller than the
+// roundoff in summing the integrand -- which matters for integrands that are
+// differences of nearly equal densities
+template <size_t N>
+struct QuadratureSegment {
+  double rmin;
+  double rmax;
+  size_t interval; // index of the mesh interval this is (a piece of)
+  std::array<double, N> integral;
+  std::array<double, N> error;
+};
+
+template <size_t N, typename T>
+QuadratureSegment<N> gaussKronrod15(const T& func, const double rmin, const double rmax,
+    const size_t interval)
+{
+  using namespace GaussKronrod15;
+  const double center = (rmin+rmax)/2;
+  const double half = (rmax-rmin)/2;
+  std::array<std::array<double, N>, 15> g;
+  for (int j=0; j<15; ++j) {
+    const int node = (j < 8) ? j : 14-j;
+    const double r = center + ((j < 7) ? -half : half) * nodes[node];
+    const std::array<double, N> f = func(r);
+    for (size_t k=0; k<N; ++k) g[j][k] = 4*M_PI*r*r*f[k];
+  }
+
+  QuadratureSegment<N> segment {rmin, rmax, interval, {}, {}};
+  for (size_t k=0; k<N; ++k) {
+    double kronrod = 0, gauss = 0, absolute = 0;
+    for (int j=0; j<15; ++j) {
+      const int node = (j < 8) ? j : 14-j;
+      kronrod += kronrodWeights[node] * g[j][k];
+      gauss += (node%2==1) ? gaussWeights[node/2] * g[j][k] : 0;
+      absolute += kronrodWeights[node] * fabs(g[j][k]);
+    }
+    double deviation = 0;
+    for (int j=0; j<15; ++j) {
+      const int node = (j < 8) ? j : 14-j;
+      deviation += kronrodWeights[node] * fabs(g[j][k] - kronrod/2);
+    }
+    double error = fabs((kronrod - gauss) * half);
+    deviation *= half;
+    if (deviation != 0 and error != 0) error = deviation * fmin(1.0, pow(200*error/deviation, 1.5));
+    error = fmax(error, 50 * 2.2e-16 * absolute * half);
+    segment.integral[k] = kronrod * half;
+    segment.error[k] = error;
+  }
+  return segment;
+}
+
+
+// the integrals of 4 pi r^2 func(r) over each interval of a mesh, for each of
+// the N components of func. every interval gets a 15-point rule; then, like
+// GSL's qag over the whole mesh, the piece with the largest error (relative
+// to its component's tolerance) is bisected until the summed error of every
+// component is within tolerance, or until the number of pieces reaches 10x
+// the number of intervals. the tolerances match integrateOverRadius(): a
+// relative 1e-6, or 1e-6 of the trapezoid estimate's magnitude. the pieces
+// are kept in a heap, worst first, as in qag; the key of each is taken with
+// the tolerance at the time it was made, which only moves as the total is
+// refined
+template <size_t N, typename T>
+std::vector<std::array<double, N>> integrateOverMeshIntervals(const T& func,
+    const std::vector<double>& rs)
+{
+  const size_t numIntervals = rs.empty() ? 0 : rs.size()-1;
+  std::vector<QuadratureSegment<N>> segments;
+  std::array<double, N> total, error, eps_abs;
+  total.fill(0);
+  error.fill(0);
+  eps_abs.fill(0);
+
+  const double eps = 1.e-6;
+  std::array<double, N> f_prev = numIntervals ? func(rs[0]) : std::array<double, N>();
+  for (size_t i=0; i<numIntervals; ++i) {
+    const std::array<double, N> f = func(rs[i+1]);
+    segments.push_back(gaussKronrod15<N>(func, rs[i], rs[i+1], i));
+    for (size_t k=0; k<N; ++k) {
+      const double g_min = 4*M_PI*rs[i]*rs[i]*f_prev[k];
+      const double g_max = 4*M_PI*rs[i+1]*rs[i+1]*f[k];
+      eps_abs[k] += eps * (rs[i+1]-rs[i]) * (fabs(g_max)+fabs(g_min)) / 2;
+      total[k] += segments.back().integral[k];
+      error[k] += segments.back().error[k];
+    }
+    f_prev = f;
+  }
+
+  // how far a piece's error is over its component's tolerance, at worst
+  std::array<double, N> tolerance;
+  const auto updateTolerance = [&] () {
+    for (size_t k=0; k<N; ++k) tolerance[k] = fmax(eps_abs[k], eps*fabs(total[k]));
+  };
+  const auto badness = [&] (const QuadratureSegment<N>& s) {
+    double worst = 0;
+    for (size_t k=0; k<N; ++k) worst = fmax(worst, s.error[k] / tolerance[k]);
+    return worst;
+  };
+
+  updateTolerance();
+  std::priority_queue<std::pair<double, size_t>> worstFirst;
+  for (size_t i=0; i<segments.size(); ++i) worstFirst.push({badness(segments[i]), i});
+
+  const size_t max_segments = 10 * numIntervals;
+  while (segments.size() < max_segments) {
+    updateTolerance();
+    bool converged = true;
+    for (size_t k=0; k<N; ++k) converged = converged and error[k] <= tolerance[k];
+    if (converged) break;
+
+    const size_t worst = worstFirst.top().second;
+    worstFirst.pop();
+    const QuadratureSegment<N> s = segments[worst];
+    const double mid = (s.rmin + s.rmax)/2;
+    segments[worst] = gaussKronrod15<N>(func, s.rmin, mid, s.interval);
+    segments.push_back(gaussKronrod15<N>(func, mid, s.rmax, s.interval));
+    for (size_t k=0; k<N; ++k) {
+      total[k] += segments[worst].integral[k] + segments.back().integral[k] - s.integral[k];
+      error[k] += segments[worst].error[k] + segments.back().error[k] - s.error[k];
+    }
+    worstFirst.push({badness(segments[worst]), worst});
+    worstFirst.push({badness(segments.back()), segments.size()-1});
+  }
+
+  std::vector<std::array<double, N>> integrals(numIntervals);
+  for (auto& integral : integrals) integral.fill(0);
+  for (const auto& s : segments) {
+    for (size_t k=0; k<N; ++k) integrals[s.interval][k] += s.integral[k];
+  }
+  return integrals;
+}
+
+
+// running integrals of 4 pi r^2 func(r) over a mesh: element i holds, for each
+// of the N components of func, the integral from rs[0] to rs[i]. all components
+// are integrated together, see integrateOverMeshIntervals()
+template <size_t N, typename T>
+std::vector<std::array<double, N>> cumulativeIntegralOverRadius(const T& func,
+    const std::vector<double>& rs)
+{
+  std::vector<std::array<double, N>> result(rs.size());
+  if (rs.empty()) return result;
+  result[0].fill(0);
+  const std::vector<std::array<double, N>> integrals = integrateOverMeshIntervals<N>(func, rs);
+  for (size_t i=1; i<rs.size(); ++i) {
+    for (size_t k=0; k<N; ++k) result[i][k] = result[i-1][k] + integrals[i-1][k];
+  }
+  return result;
+}
+
+
+// the integrals of 4 pi r^2 func(r) from rs.front() to rs.back() for each of
+// the N components of func: like integrateOverRadius(), but for several
+// integrands sharing their expensive parts (e.g. the spline lookup of phi and
+// the densities at phi), which are then evaluated once per node. the mesh --
+// e.g. that of a TfdhSolution -- is where the integrands' structure is, and
+// each of its intervals starts with its own 15-point rule
+template <size_t N, typename T>
+std::array<double, N> integrateOverRadius(const T& func, const std::vector<double>& rs)
+{
+  std::array<double, N> total;
+  total.fill(0);
+  for (const auto& integral : integrateOverMeshIntervals<N>(func, rs)) {
+    for (size_t k=0; k<N; ++k) total[k] += integral[k];
+  }
+  return total;
 }
 
 
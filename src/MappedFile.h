@@ -0,0 +1,40 @@
+#ifndef TFDH_MAPPED_FILE_H
+#define TFDH_MAPPED_FILE_H
+
+#include <cstddef>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// a read-only memory mapping of a whole file, unmapped on destruction.
+// data is null if the file couldn't be opened or mapped, or is empty
+class MappedFile {
+  public:
+    explicit MappedFile(const std::string& path) : data(nullptr), size(0) {
+      const int fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0) return;
+      struct stat st;
+      if (fstat(fd, &st) == 0 and st.st_size > 0) {
+        void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+          data = static_cast<const char*>(map);
+          size = st.st_size;
+        }
+      }
+      close(fd);
+    }
+    ~MappedFile() {
+      if (data) munmap(const_cast<char*>(data), size);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data;
+    size_t size;
+};
+
+
+#endif // TFDH_MAPPED_FILE_H
@@ -0,0 +1,210 @@
+#ifndef TFDH_NATIVE_SOLVERS_H
+#define TFDH_NATIVE_SOLVERS_H
+
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+
+// header-only counterparts of GSL::findRoot and GSL::integrate, with the same
+// arguments and the same algorithms (GSL's Brent solver, and its qag with the
+// 21-point Gauss-Kronrod rule), but taking any callable -- typically a lambda
+// -- as a template parameter. the compiler then sees the function and can
+// inline it, where the GSL versions go through a C callback and a virtual
+// call for every evaluation; this matters for the cheap integrands called
+// millions of times. they also need no workspace from the heap.
+//
+// the GSL versions in GslWrappers.h stay as the reference: the two agree to
+// within the requested tolerances
+namespace Native {
+
+  // the 21-point Gauss-Kronrod rule on [-1,1] (as QUADPACK's qk21) with its
+  // embedded 10-point Gauss rule: nodes +-nodes[j], the last one being the
+  // center; the Gauss nodes are the odd-numbered ones
+  namespace GaussKronrod21 {
+    const double nodes[11] = {
+      0.995657163025808080735527280689003, 0.973906528517171720077964012084452,
+      0.930157491355708226001207180059508, 0.865063366688984510732096688423493,
+      0.780817726586416897063717578345042, 0.679409568299024406234327365114874,
+      0.562757134668604683339000099272694, 0.433395394129247190799265943165784,
+      0.294392862701460198131126603103866, 0.148874338981631210884826001129720,
+      0.000000000000000000000000000000000};
+    const double kronrodWeights[11] = {
+      0.011694638867371874278064396062192, 0.032558162307964727478818972459390,
+      0.054755896574351996031381300244580, 0.075039674810919952767043140916190,
+      0.093125454583697605535065465083366, 0.109387158802297641899210590325805,
+      0.123491976262065851077208067625958, 0.134709217311473325928054001771707,
+      0.142775938577060080797094273138717, 0.147739104901338491374841515972068,
+      0.149445554002916905664936468389821};
+    const double gaussWeights[5] = {
+      0.066671344308688137593568809893332, 0.149451349150580593145776339657697,
+      0.219086362515982043995534934228163, 0.269266719309996355091226921569469,
+      0.295524224714752870173892994651338};
+  }
+
+  struct QuadraturePiece {
+    double a;
+    double b;
+    double integral;
+    double error;
+  };
+
+  // the 21-point rule on [a,b], with QUADPACK's error estimate (see
+  // gaussKronrod15 in IntegrateOverRadius.h)
+  template <typename F>
+  QuadraturePiece gaussKronrod21(const F& func, const double a, const double b)
+  {
+    using namespace GaussKronrod21;
+    const double center = (a+b)/2;
+    const double half = (b-a)/2;
+    std::array<double, 21> f;
+    for (int j=0; j<21; ++j) {
+      const int node = (j < 11) ? j : 20-j;
+      f[j] = func(center + ((j < 10) ? -half : half) * nodes[node]);
+    }
+
+    double kronrod = 0, gauss = 0, absolute = 0;
+    for (int j=0; j<21; ++j) {
+      const int node = (j < 11) ? j : 20-j;
+      kronrod += kronrodWeights[node] * f[j];
+      gauss += (node%2==1) ? gaussWeights[node/2] * f[j] : 0;
+      absolute += kronrodWeights[node] * fabs(f[j]);
+    }
+    double deviation = 0;
+    for (int j=0; j<21; ++j) {
+      const int node = (j < 11) ? j : 20-j;
+      deviation += kronrodWeights[node] * fabs(f[j] - kronrod/2);
+    }
+    double error = fabs((kronrod - gauss) * half);
+    deviation *= fabs(half);
+    absolute *= fabs(half);
+    if (deviation != 0 and error != 0) error = deviation * fmin(1.0, pow(200*error/deviation, 1.5));
+    error = fmax(error, 50 * std::numeric_limits<double>::epsilon() * absolute);
+    return {a, b, kronrod * half, error};
+  }
+
+
+  // find a root of func in the interval x1 to x2
+  // one of (x1,x2) or (x2,x1) MUST bracket a root
+  template <typename F>
+  double findRoot(const F& func, const double x1, const double x2,
+      const double eps_abs, const double eps_rel)
+  {
+    const Instrumentation::ScopedTimer timer(Instrumentation::Probe::FindRoot);
+    double a = fmin(x1, x2), b = fmax(x1, x2);
+    double fa = func(a), fb = func(b);
+    // check that interval brackets the root
+    assert(fa*fb <= 0);
+    if (fa == 0) return a;
+    if (fb == 0 or a == b) return b;
+
+    // Brent's method, step for step as GSL's brent solver: b is the best
+    // estimate, [b,c] the bracket, a the previous b
+    double c = b, fc = fb;
+    double d = b - a, e = b - a;
+    const int max_iter = 80;
+    for (int iter=0; iter<max_iter; ++iter) {
+      bool ac_equal = false;
+      if ((fb < 0 and fc < 0) or (fb > 0 and fc > 0)) {
+        ac_equal = true;
+        c = a;
+        fc = fa;
+        d = e = b - a;
+      }
+      if (fabs(fc) < fabs(fb)) {
+        ac_equal = true;
+        a = b; b = c; c = a;
+        fa = fb; fb = fc; fc = fa;
+      }
+
+      const double tol = 0.5 * std::numeric_limits<double>::epsilon() * fabs(b);
+      const double m = 0.5 * (c - b);
+      if (fb == 0 or fabs(m) <= tol) return b;
+
+      if (fabs(e) < tol or fabs(fa) <= fabs(fb)) {
+        d = e = m; // bisection
+      } else {
+        // inverse quadratic interpolation, or the secant if only two points
+        const double s = fb / fa;
+        double p, q;
+        if (ac_equal) {
+          p = 2 * m * s;
+          q = 1 - s;
+        } else {
+          const double qa = fa / fc;
+          const double r = fb / fc;
+          p = s * (2 * m * qa * (qa - r) - (b - a) * (r - 1));
+          q = (qa - 1) * (r - 1) * (s - 1);
+        }
+        if (p > 0) q = -q;
+        else p = -p;
+
+        if (2 * p < fmin(3 * m * q - fabs(tol * q), fabs(e * q))) {
+          e = d;
+          d = p / q;
+        } else {
+          d = e = m; // interpolation failed
+        }
+      }
+
+      a = b;
+      fa = fb;
+      b += (fabs(d) > tol) ? d : ((m > 0) ? tol : -tol);
+      fb = func(b);
+      if ((fb < 0 and fc < 0) or (fb > 0 and fc > 0)) c = a;
+
+      // same test as gsl_root_test_interval on the bracket [b,c]
+      const double lo = fmin(b, c), hi = fmax(b, c);
+      const double min_abs = ((lo > 0 and hi > 0) or (lo < 0 and hi < 0)) ? fmin(fabs(lo), fabs(hi)) : 0;
+      if (fabs(hi - lo) < eps_abs + eps_rel * min_abs) return b;
+    }
+    assert(false and "root finder failed to converge");
+    return b;
+  }
+
+
+  // definite integral of func from x1 to x2: the piece with the largest
+  // error is bisected until the summed error is within max(eps_abs, eps_rel
+  // |integral|), as in GSL's qag
+  template <typename F>
+  double integrate(const F& func, const double x1, const double x2,
+      const double eps_abs, const double eps_rel)
+  {
+    const Instrumentation::ScopedTimer timer(Instrumentation::Probe::Integrate);
+    // NOTE: the same limit as GSL::integrate
+    const size_t max_intervals = 100;
+    std::array<QuadraturePiece, max_intervals> pieces;
+
+    pieces[0] = gaussKronrod21(func, x1, x2);
+    double total = pieces[0].integral;
+    double error = pieces[0].error;
+    size_t n = 1;
+    while (error > fmax(eps_abs, eps_rel*fabs(total)) and n < max_intervals) {
+      const auto worse = [] (const QuadraturePiece& p, const QuadraturePiece& q) { return p.error < q.error; };
+      QuadraturePiece& worst = *std::max_element(pieces.begin(), pieces.begin()+n, worse);
+      const QuadraturePiece old = worst;
+      const double mid = (old.a + old.b)/2;
+      assert(mid != old.a and mid != old.b and "quadrature interval became too small");
+      worst = gaussKronrod21(func, old.a, mid);
+      pieces[n] = gaussKronrod21(func, mid, old.b);
+      total += worst.integral + pieces[n].integral - old.integral;
+      error += worst.error + pieces[n].error - old.error;
+      ++n;
+    }
+    assert(error <= fmax(eps_abs, eps_rel*fabs(total)) and "quadrature failed to reach tolerance");
+
+    // summed afresh, free of the running sum's roundoff
+    total = 0;
+    for (size_t i=0; i<n; ++i) total += pieces[i].integral;
+    return total;
+  }
+
+}
+
+
+#endif // TFDH_NATIVE_SOLVERS_H
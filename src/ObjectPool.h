@@ -0,0 +1,64 @@
+#ifndef TFDH_OBJECT_POOL_H
+#define TFDH_OBJECT_POOL_H
+
+#include <cassert>
+#include <vector>
+
+
+// a free list of heap objects of one kind (e.g. GSL workspaces of one size),
+// so that repeated uses recycle them instead of allocating and freeing each
+// time. meant to be declared thread_local, one pool per thread: then no two
+// threads share objects, and no locking (or malloc contention) is needed.
+//
+// an object is taken with acquire(), which allocates only if the list is
+// empty, and given back when its Handle goes out of scope. nested uses on one
+// thread (e.g. a quadrature inside a root find's function) just hold several
+// handles. objects come back as they were left: resetting them is the user's
+// job. Free releases an object when the pool itself is destroyed
+template <typename T, void (*Free)(T*)>
+class ObjectPool {
+  public:
+    ObjectPool() = default;
+    ~ObjectPool() {
+      for (T* object : available) Free(object);
+    }
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    class Handle {
+      public:
+        Handle(ObjectPool& pool, T* object) : pool(&pool), object(object) {
+          assert(object and "pool couldn't allocate object");
+        }
+        ~Handle() {
+          if (object) pool->available.push_back(object);
+        }
+        Handle(Handle&& other) : pool(other.pool), object(other.object) {
+          other.object = nullptr;
+        }
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+        Handle& operator=(Handle&&) = delete;
+
+        T* get() const { return object; }
+
+      private:
+        ObjectPool* pool;
+        T* object;
+    };
+
+    // allocate() is called for a new object only if none is available
+    template <typename Allocate>
+    Handle acquire(const Allocate& allocate) {
+      if (available.empty()) return Handle(*this, allocate());
+      T* object = available.back();
+      available.pop_back();
+      return Handle(*this, object);
+    }
+
+  private:
+    std::vector<T*> available;
+};
+
+
+#endif // TFDH_OBJECT_POOL_H
@@ -0,0 +1,83 @@
+
+#include "ParallelFor.h"
+
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+// one call of run(): the shares not yet taken by a worker, those running,
+// and what the finished ones counted
+struct ThreadPool::Job {
+  const std::function<void()>* work;
+  unsigned unstarted;
+  unsigned running;
+  Instrumentation::Counts counts;
+};
+
+
+ThreadPool& ThreadPool::instance()
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobPosted.notify_all();
+  for (std::thread& t : threads) t.join();
+}
+
+
+void ThreadPool::run(const unsigned numHelpers, const std::function<void()>& work)
+{
+  Job job {&work, numHelpers, 0, {}};
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (threads.size() < numHelpers) threads.emplace_back(&ThreadPool::workerLoop, this);
+    queue.push_back(&job);
+  }
+  if (numHelpers == 1) jobPosted.notify_one();
+  else jobPosted.notify_all();
+
+  work();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  if (job.unstarted > 0) {
+    queue.erase(std::find(queue.begin(), queue.end(), &job));
+    job.unstarted = 0;
+  }
+  jobDone.wait(lock, [&] { return job.running == 0; });
+  Instrumentation::addToThread(job.counts);
+}
+
+
+void ThreadPool::workerLoop()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    jobPosted.wait(lock, [&] { return stopping or not queue.empty(); });
+    if (queue.empty()) return;
+
+    Job& job = *queue.front();
+    if (--job.unstarted == 0) queue.pop_front();
+    ++job.running;
+    lock.unlock();
+    const Instrumentation::Counts before = Instrumentation::snapshot();
+    (*job.work)();
+    const Instrumentation::Counts counts = Instrumentation::snapshot() - before;
+    lock.lock();
+
+    job.counts += counts;
+    if (--job.running == 0 and job.unstarted == 0) jobDone.notify_all();
+  }
+}
@@ -0,0 +1,89 @@
+#ifndef TFDH_PARALLEL_FOR_H
+#define TFDH_PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// number of worker threads to use when the caller asks for "0", i.e. one per
+// hardware thread on this machine
+inline unsigned defaultThreadCount() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+// the worker threads behind parallelFor(), one pool for the whole process:
+// threads are started as calls first ask for them and are kept until the
+// process exits. so a call costs a wake-up rather than a thread start, and
+// what the threads keep (e.g. their GSL workspaces, see ObjectPool.h) is
+// reused from one call to the next -- by the sweep, the multisection
+// shooting and the relaxation solver alike.
+//
+// run() may be called from any thread, including from inside work being run
+// by the pool: the caller always does a share of its work itself, and only
+// waits for shares that an idle worker has started, so nested calls can't
+// deadlock on a busy pool
+class ThreadPool {
+  public:
+    static ThreadPool& instance();
+
+    // runs work() on the calling thread and on up to numHelpers pool threads
+    // at once, returning once every run has finished. work() is expected to
+    // take its tasks from a shared counter, so that the caller's run leaves
+    // nothing for helpers that start late; those are withdrawn instead.
+    //
+    // the instrumentation counts of the helpers' runs are added to the
+    // calling thread's, see Instrumentation.h
+    void run(unsigned numHelpers, const std::function<void()>& work);
+
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+  private:
+    struct Job;
+
+    ThreadPool() = default;
+    void workerLoop();
+
+    std::mutex mutex;
+    std::condition_variable jobPosted;
+    std::condition_variable jobDone;
+    std::deque<Job*> queue;
+    std::vector<std::thread> threads;
+    bool stopping = false;
+};
+
+
+// evaluate func(i) for every i in [0,n) on numThreads threads: the calling
+// thread and numThreads-1 of the ThreadPool. indices are handed out one at a
+// time from a shared counter, so tasks of very uneven cost -- e.g. TFDH solves
+// in weakly vs strongly coupled plasmas -- still keep every thread busy.
+//
+// func must be safe to call concurrently for distinct i.
+template <typename F>
+void parallelFor(const size_t n, const F& func, unsigned numThreads=0)
+{
+  if (numThreads==0) numThreads = defaultThreadCount();
+  numThreads = static_cast<unsigned>(std::min<size_t>(numThreads, n));
+
+  std::atomic<size_t> next(0);
+  const auto worker = [&] () {
+    for (size_t i=next++; i<n; i=next++) func(i);
+  };
+  if (numThreads <= 1) {
+    worker();
+    return;
+  }
+  ThreadPool::instance().run(numThreads-1, worker);
+}
+
+
+#endif // TFDH_PARALLEL_FOR_H
@@ -4,10 +4,12 @@
 #include "Composition.h"
 #include "Element.h"
 #include "Gfdi.h"
-#include "GslWrappers.h"
+#include "GfdiTable.h"
 #include "PhysicalConstants.h"
 #include "PlasmaState.h"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 
 
@@ -17,17 +19,61 @@ namespace {
   const double& hb = PhysicalConstantsCGS::Hbar;
   const double NePrefactor = pow(2.0*me, 1.5) / (2.0 * M_PI*M_PI * hb*hb*hb);
 
-  class FermiDiracDistribution : public GSL::FunctionObject {
-    private:
-      const double xi;
-      const PlasmaState p;
-    public:
-      FermiDiracDistribution(const double xi, const PlasmaState& p) : xi(xi), p(p) {}
-      double operator()(const double x) const override {
-        const double val = (1.0 + p.tau*x) * sqrt(x + p.tau * x*x/2.0) / (1.0 + exp(x-p.chi-xi));
-        return val;
+  // 8-point Gauss-Legendre rule on [-1,1], symmetric nodes and weights
+  const auto glNodes = std::array<double, 4> {{
+    0.1834346424956498, 0.5255324099163290, 0.7966664774136267, 0.9602898564975363}};
+  const auto glWeights = std::array<double, 4> {{
+    0.3626837833783620, 0.3137066458778873, 0.2223810344533745, 0.1012285362903763}};
+
+  // the incomplete Fermi-Dirac integral
+  //   int_0^a dx (1 + tau x) sqrt(x + tau x^2/2) / (1 + exp(x - eta))
+  // by fixed Gauss-Legendre panels in t = sqrt(x), which removes the
+  // square-root behavior at x=0. the integrand otherwise only has structure
+  // on a scale of 1 around the Fermi edge x=eta, or near x=0 when eta<0, so
+  // panels are split there and widen geometrically away from those points.
+  // accurate to ~1e-7 relative, with no allocation or adaptivity.
+  double incompleteFermiIntegral(const double a, const double eta, const double tau) {
+    auto breaks = std::array<double, 14> {{0, a,
+      eta-16, eta-8, eta-4, eta, eta+4, eta+8, eta+16, eta+32, 4, 8, 16, 32}};
+    for (double& b : breaks) b = fmin(fmax(b, 0.0), a);
+    std::sort(breaks.begin(), breaks.end());
+
+    double sum = 0;
+    for (size_t p=0; p+1<breaks.size(); ++p) {
+      if (not (breaks[p+1] > breaks[p])) continue;
+      const double tlo = sqrt(breaks[p]);
+      const double thi = sqrt(breaks[p+1]);
+      const double half = (thi-tlo)/2;
+      const double mid = (thi+tlo)/2;
+      for (size_t i=0; i<glNodes.size(); ++i) {
+        for (const double t : {mid - half*glNodes[i], mid + half*glNodes[i]}) {
+          const double x = t*t;
+          const double val = (1.0 + tau*x) * sqrt(x + tau * x*x/2.0) / (1.0 + exp(x-eta));
+          sum += glWeights[i] * half * 2*t * val;
+        }
       }
-  };
+    }
+    return sum;
+  }
+
+  // gfdi() at the local chi of the plasma
+  inline GfdiAllOrders localGfdi(const double chi, const PlasmaState& p,
+      const bool withDerivatives=false) {
+    return p.gfdiAllAtTau(chi, p.tau, withDerivatives);
+  }
+
+  // I_1/2 + tau I_3/2 at the local chi, which is all that ne needs, from the
+  // plasma's table if it has one
+  inline double localGfdiDensity(const double chi, const PlasmaState& p) {
+    return p.gfdiTable ? p.gfdiTable->density(chi) : p.gfdiDensityAtTau(chi, p.tau);
+  }
+
+  // and its derivative in chi
+  inline double localGfdiDensityDerivative(const double chi, const PlasmaState& p) {
+    if (p.gfdiTable) return p.gfdiTable->dDensityDchi(chi);
+    const GfdiAllOrders i = localGfdi(chi, p, true);
+    return i.dchi[static_cast<int>(GFDI::Order12)] + p.tau*i.dchi[static_cast<int>(GFDI::Order32)];
+  }
 }
 
 
@@ -40,14 +86,17 @@ double Plasma::rhoFromNe(const double ne, const Composition& comp) {
 
 
 double Plasma::ne(const double chi, const double kt, const double tau) {
-  const double i12 = gfdi(GFDI::Order12, chi, tau);
-  const double i32 = gfdi(GFDI::Order32, chi, tau);
-  return NePrefactor * pow(kt, 1.5) * (i12 + tau*i32);
+  const double i = (tau == 0) ? gfdiDensity<false>(chi, tau) : gfdiDensity<true>(chi, tau);
+  return NePrefactor * pow(kt, 1.5) * i;
+}
+
+double Plasma::gfdiDensityForNe(const double ne, const double kt) {
+  return ne / (NePrefactor * pow(kt, 1.5));
 }
 
 double Plasma::ne(const double phi, const PlasmaState& p) {
   const double xi = fmax(0, phi/p.kt);
-  return ne(p.chi + xi, p.kt, p.tau);
+  return NePrefactor * pow(p.kt, 1.5) * localGfdiDensity(p.chi+xi, p);
 }
 
 double Plasma::neBound(const double phi, const PlasmaState& p, const double cutoff) {
@@ -56,43 +105,76 @@ double Plasma::neBound(const double phi, const PlasmaState& p, const double cuto
   // * potential attractive ==> xi > 0
   // * integration bounds valid ==> (xi-cutoff) > 0
   if (xi > 0 and xi > cutoff) {
-    FermiDiracDistribution fd(xi, p);
-    const double eps = 1.e-6;
-    return NePrefactor * pow(p.kt, 1.5) * GSL::integrate(fd, 0, xi-cutoff, eps, eps);
+    return NePrefactor * pow(p.kt, 1.5) * incompleteFermiIntegral(xi-cutoff, p.chi+xi, p.tau);
   } else {
     return 0;
   }
 }
 
 std::vector<double> Plasma::ni(const double phi, const PlasmaState& p) {
+  std::vector<double> ni(p.ni.size());
+  Plasma::ni(phi, p, ni.data());
+  return ni;
+}
+
+void Plasma::ni(const double phi, const PlasmaState& p, double* ni) {
   const double xi = fmax(0, phi/p.kt);
-  std::vector<double> ni = p.ni;
-  for (size_t elem=0; elem<ni.size(); ++elem) {
-    ni[elem] *= exp(-xi * p.comp.species[elem].element.Z);
+  for (size_t elem=0; elem<p.ni.size(); ++elem) {
+    ni[elem] = p.ni[elem] * exp(-xi * p.comp.species[elem].element.Z);
   }
-  return ni;
+}
+
+double Plasma::totalIonDensity(const double phi, const PlasmaState& p) {
+  const double xi = fmax(0, phi/p.kt);
+  const std::vector<double>& z = p.ionCharges;
+  const std::vector<double>& nz = p.ionDensitiesByCharge;
+  double density = 0;
+  for (size_t i=0; i<z.size(); ++i) {
+    density += nz[i] * exp(-xi * z[i]);
+  }
+  return density;
 }
 
 
 
 double Plasma::electronKineticEnergyDensity(const double phi, const PlasmaState& p) {
   const double xi = fmax(0, phi/p.kt);
-  const double i32 = gfdi(GFDI::Order32, p.chi+xi, p.tau);
-  const double i52 = gfdi(GFDI::Order52, p.chi+xi, p.tau);
-  return NePrefactor * pow(p.kt, 2.5) * (i32 + p.tau*i52);
+  const GfdiAllOrders i = localGfdi(p.chi+xi, p);
+  return NePrefactor * pow(p.kt, 2.5) * (i[GFDI::Order32] + p.tau*i[GFDI::Order52]);
 }
 
 double Plasma::totalIonChargeDensity(const double phi, const PlasmaState& p) {
-  const std::vector<double> ni = Plasma::ni(phi, p);
+  const double xi = fmax(0, phi/p.kt);
+  const std::vector<double>& z = p.ionCharges;
+  const std::vector<double>& nz = p.ionDensitiesByCharge;
   double chargeDensity = 0;
-  for (size_t elem=0; elem<ni.size(); ++elem) {
-    chargeDensity += ni[elem] * p.comp.species[elem].element.Z;
+  for (size_t i=0; i<z.size(); ++i) {
+    chargeDensity += z[i] * nz[i] * exp(-xi * z[i]);
   }
   return chargeDensity;
 }
 
 
 
+double Plasma::dneDphi(const double phi, const PlasmaState& p) {
+  if (phi < 0) return 0;
+  return NePrefactor * pow(p.kt, 0.5) * localGfdiDensityDerivative(p.chi + phi/p.kt, p);
+}
+
+double Plasma::dTotalIonChargeDensityDphi(const double phi, const PlasmaState& p) {
+  if (phi < 0) return 0;
+  const double xi = phi/p.kt;
+  const std::vector<double>& z = p.ionCharges;
+  const std::vector<double>& nz = p.ionDensitiesByCharge;
+  double derivative = 0;
+  for (size_t i=0; i<z.size(); ++i) {
+    derivative -= z[i]*z[i] * nz[i] * exp(-xi * z[i]);
+  }
+  return derivative / p.kt;
+}
+
+
+
 double Plasma::radiusWignerSeitz(const Element& e, const PlasmaState &p) {
   return pow((3*e.Z)/(4*M_PI*p.ne), 1.0/3.0);
 }
@@ -16,14 +16,25 @@ namespace Plasma {
 
   // number densities
   double ne(double chi, double kt, double tau);
+  // the combination I_1/2 + tau I_3/2 of gfdi() making up the density ne at
+  // temperature kt, i.e. ne(chi, kt, tau) with the gfdi not yet inverted
+  double gfdiDensityForNe(double ne, double kt);
   double ne(double phi, const PlasmaState& p);
   double neBound(double phi, const PlasmaState& p, double cutoff=0);
   std::vector<double> ni(double phi, const PlasmaState& p);
+  // as above, writing into ni[0..p.ni.size()) instead of allocating
+  void ni(double phi, const PlasmaState& p, double* ni);
+  double totalIonDensity(double phi, const PlasmaState& p);
 
   // energy/charge densities
   double electronKineticEnergyDensity(double phi, const PlasmaState& p);
   double totalIonChargeDensity(double phi, const PlasmaState& p);
 
+  // derivatives with respect to phi, for linearizing the Poisson equation
+  // (zero for phi<0, where the densities are held at their background values)
+  double dneDphi(double phi, const PlasmaState& p);
+  double dTotalIonChargeDensityDphi(double phi, const PlasmaState& p);
+
   double radiusWignerSeitz(const Element& e, const PlasmaState &p);
   double energyWignerSeitz(const Element& e, const PlasmaState &p);
 
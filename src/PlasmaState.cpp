@@ -3,12 +3,16 @@
 
 #include "Composition.h"
 #include "Element.h"
-#include "GslWrappers.h"
+#include "GfdiTable.h"
 #include "PhysicalConstants.h"
 #include "PlasmaFunctions.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <limits>
+#include <memory>
+#include <utility>
 #include <vector>
 
 
@@ -30,40 +34,90 @@ namespace {
     return ni;
   }
 
-  double invertForChi(const double ne, const double kt, const double tau) {
+  std::vector<double> computeIonCharges(const Composition& comp) {
+    std::vector<double> charges;
+    for (const Species& s : comp.species) {
+      const double z = s.element.Z;
+      if (std::find(charges.begin(), charges.end(), z) == charges.end())
+        charges.push_back(z);
+    }
+    return charges;
+  }
 
-    // function to find root of:
-    class NeErrorFromChi : public GSL::FunctionObject {
-      private:
-        const double ne0, kt, tau;
-      public:
-        NeErrorFromChi(const double ne, const double kt, const double tau)
-          : ne0(ne), kt(kt), tau(tau) {}
-        double operator()(const double chi) const override {
-          // argument phi = 0
-          return Plasma::ne(chi, kt, tau) - ne0;
-        }
-    };
-    const NeErrorFromChi deltaNe(ne, kt, tau);
-
-    // find a chi interval which brackets the root
-    double chiA = 0;
-    double deltaA = deltaNe(chiA);
-    if (deltaA == 0.0) return chiA;
-    // ne(chi) is an INCREASING function, so deltaNe(chi) is too
-    const double signA = (deltaA > 0) - (deltaA < 0);
-    double chiB = - signA;
-    double deltaB = deltaNe(chiB);
-    while (deltaA*deltaB > 0.0) {
-      chiA = chiB;
-      deltaA = deltaB;
-      chiB = 2*chiB;
-      deltaB = deltaNe(chiB);
+  std::vector<double> computeIonDensitiesByCharge(const std::vector<double>& ni,
+      const std::vector<double>& charges, const Composition& comp) {
+    std::vector<double> densities(charges.size(), 0.0);
+    for (size_t elem=0; elem<ni.size(); ++elem) {
+      const double z = comp.species[elem].element.Z;
+      const size_t i = std::find(charges.begin(), charges.end(), z) - charges.begin();
+      densities[i] += ni[elem];
     }
+    return densities;
+  }
 
-    // find the root -- for this shooting problem we need max accuracy
+  double computeTau(const double kt, const bool isRel) {
+    return isRel ? (kt / PhysicalConstantsCGS::MeCC) : 0.0;
+  }
+
+  // estimate of the chi at which I_1/2 + tau I_3/2 equals d: Nilsson's fit
+  // to the inverse of the (normalized) Fermi integral F_1/2,
+  //   chi = ln u / (1 - u^2) + v / (1 + (0.24 + 1.08 v)^-2)
+  // with u = F_1/2 and v its degenerate limit (3 sqrt(pi) u / 4)^2/3, good to
+  // about 1% in chi. for tau > 0, v is replaced by the degenerate limit of
+  // the relativistic integral, where d -> (2/3) (chi + tau chi^2/2)^3/2
+  double chiGuess(const double d, const double tau) {
+    const double u = d / (sqrt(M_PI)/2);
+    const double y = pow(1.5*d, 2./3.);
+    const double v = 2*y / (1 + sqrt(1 + 2*tau*y));
+    // ln u / (1 - u^2) -> -1/2 as u -> 1
+    const double nondegenerate = (fabs(u-1) > 1e-6) ? log(u) / (1 - u*u) : -0.5;
+    const double w = 0.24 + 1.08*v;
+    return nondegenerate + v / (1 + 1/(w*w));
+  }
+
+  // solve I_1/2 + tau I_3/2 = d for chi, by Newton's method on the log of
+  // both sides starting from chiGuess(), with the derivative from gfdiAll().
+  // the log is close to linear in chi for chi << 0 and concave for chi >> 0,
+  // so the iteration converges from either side; it is kept inside the
+  // bracket it has found so far regardless
+  template <bool relativistic>
+  double invertForChi(const double d, const double tau) {
     const double eps = std::numeric_limits<double>::epsilon();
-    return GSL::findRoot(deltaNe, chiA, chiB, eps, eps);
+    const double inf = std::numeric_limits<double>::infinity();
+    double lo = -inf, hi = inf;
+    double chi = chiGuess(d, tau);
+    const int max_iter = 50;
+    for (int iter=0; iter<max_iter; ++iter) {
+      const GfdiAllOrders i = gfdiAll<relativistic>(chi, tau, true);
+      const double value = i[GFDI::Order12] + tau*i[GFDI::Order32];
+      const double slope = i.dchi[static_cast<int>(GFDI::Order12)]
+        + tau*i.dchi[static_cast<int>(GFDI::Order32)];
+      if (value == d) return chi;
+      (value < d ? lo : hi) = chi;
+
+      const double step = - log(value/d) * value/slope;
+      // for this shooting problem we need max accuracy: the step or the
+      // bracket (whose ends may straddle the root by an ulp of d) is at the
+      // roundoff of chi
+      const double tol = eps * (1 + fabs(chi));
+      if (fabs(step) <= tol) return chi + step;
+      if (hi - lo <= tol) return chi;
+      chi = (chi + step > lo and chi + step < hi) ? chi + step : (lo + hi)/2;
+    }
+    assert(false and "chi inversion failed to converge");
+    return chi;
+  }
+
+  // the gfdi table, if asked for, only for the relativistic states: at
+  // tau == 0 the analytic gfdi() is about as cheap as the table
+  std::shared_ptr<const GfdiTable> gfdiTableFor(const bool tabulateGfdi, const double tau,
+      const double chi) {
+    return (tabulateGfdi and tau > 0) ? std::make_shared<const GfdiTable>(tau, chi) : nullptr;
+  }
+
+  double invertForChi(const double ne, const double kt, const double tau) {
+    const double d = Plasma::gfdiDensityForNe(ne, kt);
+    return (tau == 0) ? invertForChi<false>(d, tau) : invertForChi<true>(d, tau);
   }
 
 } // helper namespace
@@ -72,17 +126,48 @@ namespace {
 
 PlasmaState::
 PlasmaState(const double rho, const double kt, const Composition& comp,
-    const bool isRel)
+    const bool isRel, const bool tabulateGfdi)
+: PlasmaState(rho, kt, comp, isRel,
+    invertForChi(computeNe(rho, comp), kt, computeTau(kt, isRel)),
+    computeIonCharges(comp), tabulateGfdi)
+{}
+
+
+PlasmaState::
+PlasmaState(const double rho, const double kt, const Composition& comp, const bool isRel,
+    const double chi, const std::vector<double>& ionCharges, const bool tabulateGfdi)
 : rho(rho),
   kt(kt),
   comp(comp),
   isRelativistic(isRel),
   ne(computeNe(rho, comp)),
   ni(computeNi(rho, comp)),
-  tau(isRel ? (kt / PhysicalConstantsCGS::MeCC) : 0.0),
-  chi(invertForChi(ne, kt, tau))
+  tau(computeTau(kt, isRel)),
+  chi(chi),
+  ionCharges(ionCharges),
+  ionDensitiesByCharge(computeIonDensitiesByCharge(ni, ionCharges, comp)),
+  gfdiTable(gfdiTableFor(tabulateGfdi, tau, chi)),
+  gfdiAllAtTau((tau == 0) ? gfdiAll<false> : gfdiAll<true>),
+  gfdiDensityAtTau((tau == 0) ? gfdiDensity<false> : gfdiDensity<true>)
 {
   assert(kt>0);
   assert(rho>0);
 }
 
+
+std::vector<PlasmaState> PlasmaState::batch(const std::vector<double>& rhos,
+    const std::vector<double>& kts, const Composition& comp, const bool isRel,
+    const bool tabulateGfdi)
+{
+  assert(rhos.size() == kts.size());
+  const std::vector<double> charges = computeIonCharges(comp);
+
+  std::vector<PlasmaState> states;
+  states.reserve(rhos.size());
+  for (size_t i=0; i<rhos.size(); ++i) {
+    const double tau = computeTau(kts[i], isRel);
+    const double chi = invertForChi(computeNe(rhos[i], comp), kts[i], tau);
+    states.push_back(PlasmaState(rhos[i], kts[i], comp, isRel, chi, charges, tabulateGfdi));
+  }
+  return states;
+}
@@ -3,13 +3,24 @@
 #define TFDH_PLASMA_STATE_H
 
 #include "Composition.h"
+#include "Gfdi.h"
 
+#include <memory>
 #include <vector>
 
+class GfdiTable;
+
 
 class PlasmaState {
  public:
-  PlasmaState(double rho, double kt, const Composition& comp, bool isRel);
+  PlasmaState(double rho, double kt, const Composition& comp, bool isRel,
+      bool tabulateGfdi=false);
+
+  // many states of one composition at once, the i-th at (rhos[i], kts[i]):
+  // the parts depending only on the composition are computed once
+  static std::vector<PlasmaState> batch(const std::vector<double>& rhos,
+      const std::vector<double>& kts, const Composition& comp, bool isRel,
+      bool tabulateGfdi=false);
 
   // these "primary" variables are sufficient to define the state uniquely
   const double rho;
@@ -22,6 +33,27 @@ class PlasmaState {
   const std::vector<double> ni;
   const double tau;
   const double chi;
+
+  // the ions as a structure of arrays for the hot loops: species sharing a
+  // charge are merged, so each entry is a distinct Z with the summed density
+  const std::vector<double> ionCharges;
+  const std::vector<double> ionDensitiesByCharge;
+
+  // if requested and tau > 0, the GfdiTable at this tau and chi, used by the
+  // Plasma:: electron density and its derivative in place of the analytic
+  // approximation; null otherwise
+  const std::shared_ptr<const GfdiTable> gfdiTable;
+
+  // otherwise, and for the other Plasma:: functions, the analytic gfdi()
+  // specialized for this state's tau, picked once here rather than on every
+  // call: the non-relativistic versions for tau == 0 (see Gfdi.h), the
+  // general ones otherwise
+  GfdiAllOrders (*const gfdiAllAtTau)(double chi, double tau, bool withDerivatives);
+  double (*const gfdiDensityAtTau)(double chi, double tau);
+
+ private:
+  PlasmaState(double rho, double kt, const Composition& comp, bool isRel, double chi,
+      const std::vector<double>& ionCharges, bool tabulateGfdi);
 };
 
 
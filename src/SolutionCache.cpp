@@ -0,0 +1,196 @@
+#include "SolutionCache.h"
+
+#include "Composition.h"
+#include "Element.h"
+#include "MappedFile.h"
+#include "PlasmaState.h"
+#include "TfdhBvpSolve.h"
+#include "TfdhOdeSolve.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+
+namespace {
+
+  // bump whenever a change to the solver changes its results, so that entries
+  // written by older versions are no longer found
+  const uint64_t formatVersion = 16;
+
+  const char magic[8] = {'T', 'F', 'D', 'H', 'S', 'O', 'L', '1'};
+
+  struct Header {
+    char magic[8];
+    uint64_t keySize;
+    uint64_t numPoints;
+    uint64_t numExclusionRadii;
+    double dv0;
+    double numberBoundElectrons;
+    double enclosedCharge;
+    double embeddingEnergies[8]; // fi, fe, f2, ki, ke, ni, ne, total
+  };
+
+  std::string cacheDirectory;
+
+  size_t padded(const size_t bytes) {
+    return (bytes + 7) / 8 * 8;
+  }
+
+  // appends the raw bytes of fields to a key
+  class KeyBuilder {
+    public:
+      void add(const double x) { append(&x, sizeof(x)); }
+      void add(const uint64_t n) { append(&n, sizeof(n)); }
+      void add(const std::string& s) {
+        add(static_cast<uint64_t>(s.size()));
+        append(s.data(), s.size());
+      }
+      void add(const Element& e) {
+        add(static_cast<uint64_t>(e.A));
+        add(static_cast<uint64_t>(e.Z));
+        add(e.name);
+      }
+      const std::string& str() const { return key; }
+    private:
+      void append(const void* data, const size_t size) {
+        key.append(static_cast<const char*>(data), size);
+      }
+      std::string key;
+  };
+
+  std::string makeKey(const PlasmaState& p, const Element& e, const TFDH::Method method) {
+    KeyBuilder key;
+    key.add(formatVersion);
+    key.add(static_cast<uint64_t>(method));
+    key.add(p.rho);
+    key.add(p.kt);
+    key.add(static_cast<uint64_t>(p.isRelativistic));
+    key.add(static_cast<uint64_t>(p.gfdiTable != nullptr));
+    key.add(static_cast<uint64_t>(p.comp.species.size()));
+    for (const Species& s : p.comp.species) {
+      key.add(s.massFraction);
+      key.add(s.element);
+    }
+    key.add(e);
+    return key.str();
+  }
+
+  // 64-bit FNV-1a
+  uint64_t hash(const std::string& key) {
+    uint64_t h = 14695981039346656037ull;
+    for (const char c : key) {
+      h ^= static_cast<unsigned char>(c);
+      h *= 1099511628211ull;
+    }
+    return h;
+  }
+
+  std::string entryPath(const std::string& key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.tfdh", static_cast<unsigned long long>(hash(key)));
+    return cacheDirectory + "/" + name;
+  }
+
+} // helper namespace
+
+
+
+void SolutionCache::setDirectory(const std::string& directory)
+{
+  cacheDirectory = directory;
+  if (not cacheDirectory.empty()) {
+    const int status = mkdir(cacheDirectory.c_str(), 0777);
+    assert((status == 0 or errno == EEXIST) and "couldn't create cache directory");
+  }
+}
+
+
+const std::string& SolutionCache::directory()
+{
+  return cacheDirectory;
+}
+
+
+std::unique_ptr<const SolutionCache::Entry> SolutionCache::load(const PlasmaState& p, const Element& e,
+    const TFDH::Method method)
+{
+  if (cacheDirectory.empty()) return nullptr;
+
+  const std::string key = makeKey(p, e, method);
+  const MappedFile file(entryPath(key));
+  if (not file.data or file.size < sizeof(Header)) return nullptr;
+
+  Header h;
+  std::memcpy(&h, file.data, sizeof(h));
+  if (std::memcmp(h.magic, magic, sizeof(magic)) != 0) return nullptr;
+  const size_t keyOffset = sizeof(Header);
+  const size_t arraysOffset = keyOffset + padded(h.keySize);
+  const size_t numDoubles = 2*h.numPoints + h.numExclusionRadii;
+  if (h.keySize != key.size() or file.size != arraysOffset + numDoubles*sizeof(double)) return nullptr;
+  if (std::memcmp(file.data + keyOffset, key.data(), key.size()) != 0) return nullptr; // collision
+
+  const double* r = reinterpret_cast<const double*>(file.data + arraysOffset);
+  const double* phi = r + h.numPoints;
+  const double* rex = phi + h.numPoints;
+  const double* en = h.embeddingEnergies;
+  return std::unique_ptr<const Entry>(new Entry {
+      h.dv0,
+      std::vector<double>(r, r + h.numPoints),
+      std::vector<double>(phi, phi + h.numPoints),
+      {h.numberBoundElectrons, h.enclosedCharge,
+        {en[0], en[1], en[2], en[3], en[4], en[5], en[6], en[7]}},
+      std::vector<double>(rex, rex + h.numExclusionRadii)});
+}
+
+
+void SolutionCache::store(const PlasmaState& p, const Element& e, const TFDH::Method method,
+    const Entry& entry)
+{
+  if (cacheDirectory.empty()) return;
+  assert(entry.r.size() == entry.phi.size());
+
+  const std::string key = makeKey(p, e, method);
+  const TFDH::EnergyDeltas& en = entry.integrals.embeddingEnergies;
+  Header h;
+  std::memcpy(h.magic, magic, sizeof(magic));
+  h.keySize = key.size();
+  h.numPoints = entry.r.size();
+  h.numExclusionRadii = entry.exclusionRadii.size();
+  h.dv0 = entry.dv0;
+  h.numberBoundElectrons = entry.integrals.numberBoundElectrons;
+  h.enclosedCharge = entry.integrals.enclosedCharge;
+  const double energies[8] = {en.fi, en.fe, en.f2, en.ki, en.ke, en.ni, en.ne, en.total};
+  std::memcpy(h.embeddingEnergies, energies, sizeof(energies));
+
+  // write under a name unique to this process and thread, then move into place
+  const std::string path = entryPath(key);
+  std::ostringstream tmp;
+  tmp << path << ".tmp." << getpid() << "." << std::hash<std::thread::id>()(std::this_thread::get_id());
+  {
+    std::ofstream outfile(tmp.str(), std::ios::binary);
+    assert(outfile and "couldn't open cache file");
+    const char padding[8] = {};
+    outfile.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    outfile.write(key.data(), key.size());
+    outfile.write(padding, padded(key.size()) - key.size());
+    outfile.write(reinterpret_cast<const char*>(entry.r.data()), entry.r.size()*sizeof(double));
+    outfile.write(reinterpret_cast<const char*>(entry.phi.data()), entry.phi.size()*sizeof(double));
+    outfile.write(reinterpret_cast<const char*>(entry.exclusionRadii.data()),
+        entry.exclusionRadii.size()*sizeof(double));
+    assert(outfile and "couldn't write cache file");
+  }
+  const int status = std::rename(tmp.str().c_str(), path.c_str());
+  assert(status == 0 and "couldn't move cache file into place");
+}
@@ -0,0 +1,55 @@
+#ifndef TFDH_SOLUTION_CACHE_H
+#define TFDH_SOLUTION_CACHE_H
+
+#include "TfdhBvpSolve.h"
+#include "TfdhOdeSolve.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class Element;
+class PlasmaState;
+
+
+// Persistent on-disk cache of TFDH solutions, so that points already solved in
+// an earlier run are read back instead of solved again.
+//
+// Each entry is one binary file in the cache directory, named by a hash of
+// everything that determines the solution: the plasma state's primary
+// variables (including whether gfdi is tabulated), the trace ion, the
+// TFDH::Method asked for, and a format version to be bumped whenever the
+// solver's results change. The file also holds the full key, so hash
+// collisions are detected rather than served. Files are written under a
+// temporary name and renamed into place, so concurrent writers (threads or
+// processes) never expose partial entries.
+//
+// Layout: a header of 8-byte fields, then the key padded to 8 bytes, then the
+// arrays r, phi, exclusion radii -- all doubles in native byte order, so a
+// reader can map the file and use the arrays in place.
+namespace SolutionCache {
+
+  struct Entry {
+    const double dv0;
+    const std::vector<double> r;
+    const std::vector<double> phi;
+    const TFDH::SolutionIntegrals integrals;
+    const std::vector<double> exclusionRadii;
+  };
+
+  // where entries are read and written; created if needed. an empty string
+  // (the default) disables the cache. not to be changed while solving.
+  void setDirectory(const std::string& directory);
+  const std::string& directory();
+
+  // the cached entry for this point, or null if there is none (or the cache
+  // is disabled)
+  std::unique_ptr<const Entry> load(const PlasmaState& p, const Element& e, TFDH::Method method);
+
+  // does nothing if the cache is disabled
+  void store(const PlasmaState& p, const Element& e, TFDH::Method method, const Entry& entry);
+
+}
+
+
+#endif // TFDH_SOLUTION_CACHE_H
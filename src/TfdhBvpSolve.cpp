@@ -0,0 +1,325 @@
+#include "TfdhBvpSolve.h"
+
+#include "Element.h"
+#include "ParallelFor.h"
+#include "PhysicalConstants.h"
+#include "PlasmaFunctions.h"
+#include "PlasmaState.h"
+#include "TfdhSolution.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+
+// The Poisson equation for u = r phi / qe, u'' = f(r, u), is brought to the
+// mesh coordinate x = c ln r + k r by the Liouville transformation
+//   u = Z qe rhoHat v,  rhoHat = sqrt(w / w_0),  w = dr/dx = r / (c + k r)
+// which leaves no first derivative:
+//   d^2 v / dx^2 = g(x, v) = w^2 f / (Z qe rhoHat) + q v,  q = c (c/4 + k r) / (c + k r)^4
+// so that Numerov's method applies on the uniform mesh in x: at the inner
+// nodes,
+//   v_i+1 - 2 v_i + v_i-1 = h^2/12 (g_i+1 + 10 g_i + g_i-1)
+// v is of order 1 at the inner radius (where rhoHat = 1 and u ~ Z qe).
+namespace {
+
+  // c above: the nodes per screening length of the tail, relative to those
+  // per e-fold of the radius. the error of the solution is largest within
+  // 0.1 r_ws, where the mesh is geometric; in the strongly coupled states
+  // (k r_ws ~ 100 and more) the mesh is otherwise spent on the ion sphere,
+  // which the ions avoid, and this cut the nodes ~8-fold there
+  const double log_weight = 8.0;
+
+  // from the ion sphere to the outer radius
+  const double tail_screening_lengths = 20.0;
+
+  // the spacing in x of the first mesh, i.e. half a screening length in the
+  // tail: Newton's method doesn't converge on coarser ones in the strongly
+  // coupled states, where the ion density varies over the screening length
+  const double initial_spacing = 0.5;
+  const size_t max_intervals = size_t(1) << 16;
+
+  // on u / (Z qe): the error of the solution, as estimated from its change
+  // when the mesh is halved (1/15 of it, for a 4th-order method)
+  const double tolerance = 1e-8;
+
+  // on the Newton steps of v
+  const double newton_tolerance = 1e-10;
+  const int max_newton_steps = 50;
+  const int max_step_halvings = 30;
+
+  // nodes per task when the densities are evaluated on several threads; and
+  // the fewest nodes per thread. the threads are those of the ThreadPool, so
+  // each evaluation only wakes them, which costs about as much as evaluating
+  // the densities at a few tens of nodes
+  const size_t block_size = 256;
+  const size_t min_nodes_per_thread = 512;
+
+  struct Mesh {
+    double h; // the spacing in x
+    std::vector<double> r;
+    std::vector<double> w;
+    std::vector<double> rhoHat;
+    std::vector<double> q;
+    std::vector<double> dLogRhoHat; // d ln(rhoHat) / dx
+  };
+
+  Mesh makeMesh(const double r_init, const double r_final, const double k, const size_t intervals) {
+    const double& c = log_weight;
+    const double x_init = c*log(r_init) + k*r_init;
+    const double x_final = c*log(r_final) + k*r_final;
+    Mesh m {(x_final - x_init) / intervals, {}, {}, {}, {}, {}};
+    m.r.resize(intervals+1);
+    // ln r from x by Newton's method, starting from the node before: x is
+    // convex in ln r, so this converges from either side
+    double t = log(r_init);
+    for (size_t i=0; i<=intervals; ++i) {
+      const double x = x_init + i*m.h;
+      for (int iter=0; iter<50; ++iter) {
+        const double step = (c*t + k*exp(t) - x) / (c + k*exp(t));
+        t -= step;
+        if (fabs(step) <= 1e-15 * (1 + fabs(t))) break;
+      }
+      m.r[i] = exp(t);
+    }
+    m.r.front() = r_init;
+    m.r.back() = r_final;
+
+    for (const double r : m.r) {
+      const double a = c + k*r;
+      m.w.push_back(r / a);
+      m.rhoHat.push_back(sqrt(m.w.back() / m.w.front()));
+      m.q.push_back(c * (0.25*c + k*r) / (a*a*a*a));
+      m.dLogRhoHat.push_back(0.5*c / (a*a));
+    }
+    return m;
+  }
+
+  // g and dg/dv at every node, for the state v
+  void evaluate(const Mesh& m, const PlasmaState& p, const double scale, const std::vector<double>& v,
+      std::vector<double>& g, std::vector<double>& dg, const unsigned numThreads)
+  {
+    const double& qe = PhysicalConstantsCGS::ElectronCharge;
+    const size_t n = v.size();
+    g.resize(n);
+    dg.resize(n);
+    const auto evaluateBlock = [&] (const size_t block) {
+      const size_t end = std::min(n, (block+1)*block_size);
+      for (size_t i=block*block_size; i<end; ++i) {
+        const double r = m.r[i];
+        const double phi = qe * scale * m.rhoHat[i] * v[i] / r;
+        const double chargeDensity = Plasma::totalIonChargeDensity(phi, p) - Plasma::ne(phi, p);
+        const double dChargeDensity = Plasma::dTotalIonChargeDensityDphi(phi, p) - Plasma::dneDphi(phi, p);
+        const double f = -4.0*M_PI*qe * r * chargeDensity;
+        const double dfdu = -4.0*M_PI*qe*qe * dChargeDensity;
+        const double w2 = m.w[i] * m.w[i];
+        g[i] = w2 * f / (scale * m.rhoHat[i]) + m.q[i] * v[i];
+        dg[i] = w2 * dfdu + m.q[i];
+      }
+    };
+    const size_t maxThreads = std::max<size_t>(1, n / min_nodes_per_thread);
+    const unsigned threads = static_cast<unsigned>(
+        std::min<size_t>((numThreads == 0) ? defaultThreadCount() : numThreads, maxThreads));
+    parallelFor((n + block_size - 1) / block_size, evaluateBlock, threads);
+  }
+
+  // the residuals of the discrete equations: the Coulomb condition, the
+  // Numerov equations, and the condition of the screened tail. at the ends,
+  // dv/dx is the one-sided estimate
+  //   dv/dx_0 = (v_1 - v_0)/h - h/24 (7 g_0 + 6 g_1 - g_2)
+  // (and its mirror image), which is of the same order as Numerov's
+  // equations. returns the largest residual, with the Numerov equations
+  // divided by h^2 so that all are of the size of a derivative
+  double residuals(const Mesh& m, const double k, const std::vector<double>& v,
+      const std::vector<double>& g, std::vector<double>& res)
+  {
+    const size_t n = v.size();
+    const size_t last = n-1;
+    const double h = m.h;
+    res.resize(n);
+
+    // u - r du/dr = Z qe, where r du/dr = Z qe rhoHat (c + k r) (dv/dx + v dln(rhoHat)/dx)
+    const double a0 = m.r[0] / m.w[0];
+    const double dv0 = (v[1] - v[0])/h - h/24 * (7*g[0] + 6*g[1] - g[2]);
+    res[0] = v[0] - a0 * (m.dLogRhoHat[0] * v[0] + dv0) - 1;
+    double largest = fabs(res[0]);
+
+    for (size_t i=1; i<last; ++i) {
+      res[i] = v[i+1] - 2*v[i] + v[i-1] - h*h/12 * (g[i+1] + 10*g[i] + g[i-1]);
+      largest = std::max(largest, fabs(res[i]) / (h*h));
+    }
+
+    // du/dr = -k u
+    const double dvN = (v[last] - v[last-1])/h + h/24 * (7*g[last] + 6*g[last-1] - g[last-2]);
+    res[last] = dvN + (m.dLogRhoHat[last] + k*m.w[last]) * v[last];
+    return std::max(largest, fabs(res[last]));
+  }
+
+  // the Newton step: solves J step = -res for the Jacobian J of residuals().
+  // J is tridiagonal but for one more entry in each of the boundary rows,
+  // which is eliminated with the neighbouring Numerov row first
+  std::vector<double> newtonStep(const Mesh& m, const double k, const std::vector<double>& dg,
+      const std::vector<double>& res)
+  {
+    const size_t n = dg.size();
+    const size_t last = n-1;
+    const double h = m.h;
+    const double c = h*h/12;
+    std::vector<double> lower(n, 0.0), diag(n), upper(n, 0.0), rhs(n);
+    for (size_t i=0; i<n; ++i) rhs[i] = -res[i];
+    for (size_t i=1; i<last; ++i) {
+      lower[i] = 1 - c*dg[i-1];
+      diag[i] = -2 - 10*c*dg[i];
+      upper[i] = 1 - c*dg[i+1];
+    }
+
+    const double a0 = m.r[0] / m.w[0];
+    diag[0] = 1 - a0 * (m.dLogRhoHat[0] - 1/h - 7*h/24*dg[0]);
+    upper[0] = -a0 * (1/h - 6*h/24*dg[1]);
+    const double extraFirst = -a0 * (h/24*dg[2]);
+    const double mFirst = extraFirst / upper[1];
+    diag[0] -= mFirst * lower[1];
+    upper[0] -= mFirst * diag[1];
+    rhs[0] -= mFirst * rhs[1];
+
+    diag[last] = 1/h + 7*h/24*dg[last] + (m.dLogRhoHat[last] + k*m.w[last]);
+    lower[last] = -1/h + 6*h/24*dg[last-1];
+    const double extraLast = -h/24*dg[last-2];
+    const double mLast = extraLast / lower[last-1];
+    lower[last] -= mLast * diag[last-1];
+    diag[last] -= mLast * upper[last-1];
+    rhs[last] -= mLast * rhs[last-1];
+
+    // Thomas algorithm
+    for (size_t i=1; i<n; ++i) {
+      const double f = lower[i] / diag[i-1];
+      diag[i] -= f * upper[i-1];
+      rhs[i] -= f * rhs[i-1];
+    }
+    std::vector<double> step(n);
+    step[last] = rhs[last] / diag[last];
+    for (size_t i=last; i-- > 0;) {
+      step[i] = (rhs[i] - upper[i]*step[i+1]) / diag[i];
+    }
+    return step;
+  }
+
+  // Newton's method on the discrete equations, from the guess v. a step that
+  // doesn't reduce the largest residual is halved until it does, which keeps
+  // the iteration on track from a rough guess
+  void relax(const Mesh& m, const PlasmaState& p, const double k, const double scale,
+      std::vector<double>& v, const unsigned numThreads)
+  {
+    std::vector<double> g, dg, res;
+    evaluate(m, p, scale, v, g, dg, numThreads);
+    double largest = residuals(m, k, v, g, res);
+
+    std::vector<double> trial(v.size()), g_trial, dg_trial, res_trial;
+    for (int iter=0; iter<max_newton_steps; ++iter) {
+      const std::vector<double> step = newtonStep(m, k, dg, res);
+
+      // near the root the residuals are at roundoff and no longer decrease,
+      // so the last step is taken whole
+      double change = 0;
+      for (const double s : step) change = std::max(change, fabs(s));
+      if (change <= newton_tolerance) {
+        for (size_t i=0; i<v.size(); ++i) v[i] += step[i];
+        return;
+      }
+
+      double lambda = 1;
+      for (int halving=0; halving<=max_step_halvings; ++halving) {
+        for (size_t i=0; i<v.size(); ++i) trial[i] = v[i] + lambda*step[i];
+        evaluate(m, p, scale, trial, g_trial, dg_trial, numThreads);
+        const double largest_trial = residuals(m, k, trial, g_trial, res_trial);
+        if (largest_trial < largest or halving == max_step_halvings) {
+          largest = largest_trial;
+          break;
+        }
+        lambda /= 2;
+      }
+      std::swap(v, trial);
+      std::swap(g, g_trial);
+      std::swap(dg, dg_trial);
+      std::swap(res, res_trial);
+    }
+    assert(false and "relaxation failed to converge");
+  }
+
+} // helper namespace
+
+
+
+TfdhSolution TFDH::solveRelaxation(const Element& e, const PlasmaState& p, const unsigned numThreads)
+{
+  const double& qe = PhysicalConstantsCGS::ElectronCharge;
+  const double scale = qe*e.Z;
+  // screening wavenumber of the background, from the linearized Poisson
+  // equation at phi = 0
+  const double dChargeDensity = Plasma::dTotalIonChargeDensityDphi(0.0, p) - Plasma::dneDphi(0.0, p);
+  const double k = sqrt(-4.0*M_PI*qe*qe * dChargeDensity);
+  // the inner radius and the largest outer one are those of the shooting
+  const double rws = Plasma::radiusWignerSeitz(e, p);
+  const double r_init = 1e-4 * rws;
+  const double r_final = std::min(1e3 * rws, rws + tail_screening_lengths / k);
+
+  size_t intervals = static_cast<size_t>(ceil(
+        (log_weight * log(r_final / r_init) + k * (r_final - r_init)) / initial_spacing));
+  Mesh mesh = makeMesh(r_init, r_final, k, intervals);
+
+  // first guess: the larger of the screened Coulomb potential of the bare
+  // ion and the potential of its neutral ion sphere, which it is close to
+  // when the coupling is strong. from the screened potential alone, Newton's
+  // method takes a step per few screening lengths into the ion sphere
+  std::vector<double> v(intervals+1);
+  for (size_t i=0; i<=intervals; ++i) {
+    const double screened = exp(-k*(mesh.r[i] - r_init));
+    const double x = std::min(mesh.r[i] / rws, 1.0);
+    const double ionSphere = (1-x)*(1-x)*(1+0.5*x);
+    v[i] = std::max(screened, ionSphere) / mesh.rhoHat[i];
+  }
+  relax(mesh, p, k, scale, v, numThreads);
+
+  // each halving of the mesh starts from the solution on the one before,
+  // interpolated linearly in x
+  while (true) {
+    assert(2*intervals <= max_intervals and "relaxation didn't converge on refining the mesh");
+    Mesh fine = makeMesh(r_init, r_final, k, 2*intervals);
+    std::vector<double> v_fine(2*intervals+1);
+    for (size_t i=0; i<=intervals; ++i) v_fine[2*i] = v[i];
+    for (size_t i=0; i<intervals; ++i) {
+      const double y = 0.5 * (mesh.rhoHat[i]*v[i] + mesh.rhoHat[i+1]*v[i+1]);
+      v_fine[2*i+1] = y / fine.rhoHat[2*i+1];
+    }
+    relax(fine, p, k, scale, v_fine, numThreads);
+
+    double change = 0;
+    for (size_t i=0; i<=intervals; ++i) {
+      change = std::max(change, mesh.rhoHat[i] * fabs(v_fine[2*i] - v[i]));
+    }
+    mesh = std::move(fine);
+    v = std::move(v_fine);
+    intervals *= 2;
+    if (change / 15 <= tolerance) break;
+  }
+
+  // dv0 = du/dr at r_init, from the equation integrated over the mesh,
+  //   du/dr(r_init) = du/dr(r_final) - \int f dr,  du/dr(r_final) = -k u(r_final)
+  // by Simpson's rule in x (dr = w dx): the refined mesh has an even number
+  // of intervals. unlike the Coulomb condition, u(r_init) = Z qe + r_init dv0,
+  // this doesn't magnify the error of u(r_init) by 1/r_init
+  assert(intervals % 2 == 0);
+  std::vector<double> phis(v.size());
+  double integral = 0;
+  for (size_t i=0; i<v.size(); ++i) {
+    phis[i] = qe * scale * mesh.rhoHat[i] * v[i] / mesh.r[i];
+    const double chargeDensity = Plasma::totalIonChargeDensity(phis[i], p) - Plasma::ne(phis[i], p);
+    const double weight = (i == 0 or i == intervals) ? 1 : (i % 2) ? 4 : 2;
+    integral += weight * (-4.0*M_PI*qe * mesh.r[i] * chargeDensity) * mesh.w[i];
+  }
+  integral *= mesh.h / 3;
+  const double dv0 = -k * scale * mesh.rhoHat.back() * v.back() - integral;
+  return TfdhSolution(mesh.r, phis, dv0);
+}
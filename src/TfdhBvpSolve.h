@@ -0,0 +1,58 @@
+#ifndef TFDH_TFDH_BVP_SOLVE_H
+#define TFDH_TFDH_BVP_SOLVE_H
+
+#include "TfdhSolution.h"
+
+class Element;
+class PlasmaState;
+
+
+namespace TFDH {
+
+  // the alternative to the shooting of solve(): the Poisson equation as a
+  // boundary-value problem, solved on the whole radial mesh at once by
+  // Newton's method (relaxation), with
+  //   - the Coulomb condition at the inner radius: near the ion the
+  //     potential is its bare Coulomb potential plus a constant, i.e.
+  //     u - r du/dr = Z qe for u = r phi / qe
+  //   - neutrality at the outer radius: the potential there is the screened
+  //     tail of the linearized equation, u ~ exp(-k r), so no charge is left
+  //     beyond it but that of the tail itself
+  //
+  // the mesh is uniform in x = 8 ln r + k r, for k the screening wavenumber
+  // of the background plasma: geometric where k r is small, with 8 times as
+  // many nodes per e-fold of r as per screening length, and uniform over the
+  // screening lengths of the tail. the equation is discretized by Numerov's (4th-order) method,
+  // so every Newton step is a tridiagonal solve; the mesh is refined by
+  // halving until the change of the solution shows it converged.
+  //
+  // the solution ends at the outer radius -- a fixed number of screening
+  // lengths beyond the ion sphere -- rather than where a shot diverges; its
+  // TFDH::integrals() are those of TfdhFunctions.h, over its spline.
+  //
+  // its dv0, the initial slope, is the equation integrated over the mesh
+  // (Simpson's rule) from the slope of the tail; it agrees with the shooting's
+  // to ~1e-5 or better wherever the shooting is exact (see Method). so it can
+  // warm-start solve(), and the sweeps' extrapolation along a path.
+  //
+  // numThreads threads of the ThreadPool (0 => one per core) evaluate the
+  // densities on blocks of the mesh, which is most of the work of a Newton
+  // step. each thread gets at least 512 nodes, so that waking it is cheap
+  // against its share: the usual meshes of 450-3500 nodes use up to 6 threads
+  TfdhSolution solveRelaxation(const Element& e, const PlasmaState& p, unsigned numThreads=1);
+
+  // how TfdhIon solves for the potential: by the Newton shooting of solve(),
+  // or by relaxation.
+  //
+  // the shooting has a limit: where the ions are strongly coupled (k r_ws
+  // above ~130, e.g. rho >= 1e9 at T = 1e6 in carbon), a shot diverges within
+  // the ion sphere even with dv0 bracketed to adjacent doubles. the solution
+  // then ends there, leaving out a net charge of ~0.2 Z, and its embedding
+  // energy is ~12% off. the net charge of an exact shot is below 1e-3 Z, so
+  // TfdhIon checks the shot's, and falls back on relaxation if it's larger
+  enum class Method {Shooting, Relaxation};
+
+}
+
+
+#endif // TFDH_TFDH_BVP_SOLVE_H
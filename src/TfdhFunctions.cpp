@@ -2,33 +2,17 @@
 #include "TfdhFunctions.h"
 
 #include "Element.h"
-#include "GslWrappers.h"
 #include "IntegrateOverRadius.h"
+#include "NativeSolvers.h"
 #include "PhysicalConstants.h"
 #include "PlasmaFunctions.h"
 #include "PlasmaState.h"
 #include "TfdhSolution.h"
 
+#include <array>
 #include <cmath>
 
 
-namespace {
-  class EnergyDiff : public GSL::FunctionObject {
-    private:
-      const TfdhSolution& tfdh;
-      const double kt;
-      const int zion;
-    public:
-      EnergyDiff(const TfdhSolution& tfdh, const double kt, const int zion)
-        : tfdh(tfdh), kt(kt), zion(zion) {}
-      double operator()(const double r) const override {
-        return zion * tfdh(r) - kt;
-      }
-  };
-} // helper namespace
-
-
-
 double TFDH::boundElectrons(const TfdhSolution& tfdh, const PlasmaState& p, const double cutoff)
 {
   const auto f_ne_bound = [&] (const double r) -> double {return Plasma::neBound(tfdh(r), p, cutoff);};
@@ -43,10 +27,11 @@ std::vector<double> TFDH::exclusionRadii(const TfdhSolution& tfdh,
   //   E_thermal == E_electrostatic  =>  kt == Zion phi
   std::vector<double> rexcl(p.ni);
   for (size_t elem=0; elem<rexcl.size(); ++elem) {
-    const EnergyDiff delta(tfdh, p.kt, p.comp.species[elem].element.Z);
+    const int zion = p.comp.species[elem].element.Z;
+    const auto delta = [&] (const double r) {return zion * tfdh(r) - p.kt;};
     const double eps_abs = 1e-6 * Plasma::radiusWignerSeitz(e, p);
     const double eps_rel = 1e-6;
-    rexcl[elem] = GSL::findRoot(delta, tfdh.r.front(), tfdh.r.back(), eps_abs, eps_rel);
+    rexcl[elem] = Native::findRoot(delta, tfdh.r.front(), tfdh.r.back(), eps_abs, eps_rel);
   }
   return rexcl;
 }
@@ -55,37 +40,35 @@ std::vector<double> TFDH::exclusionRadii(const TfdhSolution& tfdh,
 TFDH::EnergyDeltas TFDH::embeddingEnergy(const TfdhSolution& tfdh,
     const Element& e, const PlasmaState& p)
 {
-  const auto f_dfi = [&] (const double r) -> double {return tfdh(r) * Plasma::totalIonChargeDensity(tfdh(r), p);};
-  const double fi = integrateOverRadius(f_dfi, tfdh.r.front(), tfdh.r.back());
-
-  const auto f_dfe = [&] (const double r) -> double {return - tfdh(r) * Plasma::ne(tfdh(r), p);};
-  const double fe = integrateOverRadius(f_dfe, tfdh.r.front(), tfdh.r.back());
-
-  const auto f_fce = [&] (const double r) -> double {
-    const double& qe = PhysicalConstantsCGS::ElectronCharge;
+  // all the energy terms are integrated together, sharing the evaluations of
+  // phi and the densities at each node
+  const double& qe = PhysicalConstantsCGS::ElectronCharge;
+  const double ni0 = Plasma::totalIonDensity(0.0, p);
+  const double ke0 = Plasma::electronKineticEnergyDensity(0.0, p);
+  const auto f_energies = [&] (const double r) -> std::array<double, 6> {
     const double phi = tfdh(r);
     const double phi_ext = e.A * qe * qe / r;
-    return 0.5 * (Plasma::totalIonChargeDensity(phi, p) - Plasma::ne(phi, p)) * (phi_ext - phi);
-  };
-  const double f2 = integrateOverRadius(f_fce, tfdh.r.front(), tfdh.r.back());
-
-  const auto f_dni = [&] (const double r) -> double {
-    double dni = 0;
-    for (size_t i=0; i<p.ni.size(); ++i) {
-      dni += Plasma::ni(tfdh(r), p)[i] - p.ni[i];
-    }
-    return dni;
+    const double ionChargeDensity = Plasma::totalIonChargeDensity(phi, p);
+    const double ne = Plasma::ne(phi, p);
+    return {{
+      phi * ionChargeDensity,                               // field energy of ions
+      - phi * ne,                                           // field energy of electrons
+      0.5 * (ionChargeDensity - ne) * (phi_ext - phi),      // field energy overcounting
+      Plasma::totalIonDensity(phi, p) - ni0,                // change in ion number
+      Plasma::electronKineticEnergyDensity(phi, p) - ke0,   // change in e- kinetic energy
+      ne - p.ne}};                                          // change in e- number
   };
-  const double ki = 1.5 * p.kt * integrateOverRadius(f_dni, tfdh.r.front(), tfdh.r.back());
+  const std::array<double, 6> integrals = integrateOverRadius<6>(f_energies, tfdh.r);
 
-  const auto f_dke = [&] (const double r) -> double {
-    return Plasma::electronKineticEnergyDensity(tfdh(r), p) - Plasma::electronKineticEnergyDensity(0.0, p);};
-  const double ke = integrateOverRadius(f_dke, tfdh.r.front(), tfdh.r.back());
+  const double fi = integrals[0];
+  const double fe = integrals[1];
+  const double f2 = integrals[2];
+  const double ki = 1.5 * p.kt * integrals[3];
+  const double ke = integrals[4];
 
   // TODO: are these even physically motivated?
   const double dni = ki;
-  const auto f_dne = [&] (const double r) -> double {return Plasma::ne(tfdh(r), p) - p.ne;};
-  const double dne = (Plasma::electronKineticEnergyDensity(0.0,p) / p.ne) * integrateOverRadius(f_dne, tfdh.r.front(), tfdh.r.back());
+  const double dne = (ke0 / p.ne) * integrals[5];
 
   return {fi, fe, f2, ki, ke, dni, dne, fi+fe+f2+ki+ke-dni-dne};
 }
@@ -9,6 +9,13 @@ class PlasmaState;
 class TfdhSolution;
 
 
+// boundElectrons() and embeddingEnergy() are quadratures of a solution over
+// its spline, from tfdh.r.front() to tfdh.r.back(). solutions of the Newton
+// shooting, which TfdhIon uses, don't need them: they carry these integrals
+// on their trajectory (see TFDH::integrals() in TfdhOdeSolve.h). the two are
+// what TFDH::integrals() falls back on for any other solution: those of the
+// other shootings, of the relaxation solver (TfdhBvpSolve.h), and those
+// rebuilt from a mesh
 namespace TFDH {
 
   double boundElectrons(const TfdhSolution& tfdh, const PlasmaState& p, double cutoff=0);
@@ -26,6 +33,7 @@ namespace TFDH {
     const double total;
   };
 
+  // the terms are integrated together, on shared nodes
   EnergyDeltas embeddingEnergy(const TfdhSolution& tfdh, const Element& e, const PlasmaState& p);
 
 }
@@ -1,30 +1,79 @@
 
 #include "TfdhIon.h"
 
+#include "ColumnarFile.h"
 #include "Element.h"
+#include "Instrumentation.h"
 #include "IntegrateOverRadius.h"
 #include "PhysicalConstants.h"
 #include "PlasmaFunctions.h"
 #include "PlasmaState.h"
+#include "SolutionCache.h"
+#include "TfdhBvpSolve.h"
 #include "TfdhFunctions.h"
 #include "TfdhOdeSolve.h"
 #include "TfdhSolution.h"
 #include "Utils.h"
 
+#include <array>
+#include <cmath>
 #include <fstream>
+#include <memory>
 #include <ostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
 
-TfdhIon::TfdhIon(const PlasmaState& plasmaState, const Element& element)
+namespace {
+
+  // a shot with a larger net charge, in units of Z, diverged within the ion
+  // sphere, see TFDH::Method
+  const double max_shot_net_charge = 1e-2;
+
+  TfdhSolution solveFor(const Element& e, const PlasmaState& p, const double dv0Guess,
+      const TFDH::Method method)
+  {
+    if (method == TFDH::Method::Shooting) {
+      TfdhSolution shot = TFDH::solve(e, p, dv0Guess);
+      if (fabs(TFDH::integrals(shot, e, p).enclosedCharge) <= max_shot_net_charge * e.Z) return shot;
+    }
+    return TFDH::solveRelaxation(e, p);
+  }
+
+} // helper namespace
+
+
+
+TfdhIon::TfdhIon(const PlasmaState& plasmaState, const Element& element, const TFDH::Method method)
+: TfdhIon(plasmaState, element, 0.0, method)
+{}
+
+
+TfdhIon::TfdhIon(const PlasmaState& plasmaState, const Element& element, const double dv0Guess,
+    const TFDH::Method method)
+: TfdhIon(plasmaState, element, dv0Guess, method,
+    Instrumentation::Region(Instrumentation::Probe::TfdhIon),
+    SolutionCache::load(plasmaState, element, method))
+{}
+
+
+TfdhIon::TfdhIon(const PlasmaState& plasmaState, const Element& element, const double dv0Guess,
+    const TFDH::Method method, const Instrumentation::Region& build,
+    std::unique_ptr<const SolutionCache::Entry> cached)
 : ps(plasmaState),
   e(element),
-  tfdh(TFDH::solve(e, ps)),
-  numberBoundElectrons(TFDH::boundElectrons(tfdh, ps)),
-  embeddingEnergies(TFDH::embeddingEnergy(tfdh, e, ps)),
-  exclusionRadii(TFDH::exclusionRadii(tfdh, e, ps))
-{}
+  tfdh(cached ? TfdhSolution(cached->r, cached->phi, cached->dv0) : solveFor(e, ps, dv0Guess, method)),
+  integrals(cached ? cached->integrals : TFDH::integrals(tfdh, e, ps)),
+  numberBoundElectrons(integrals.numberBoundElectrons),
+  embeddingEnergies(integrals.embeddingEnergies),
+  exclusionRadii(cached ? cached->exclusionRadii : TFDH::exclusionRadii(tfdh, e, ps)),
+  cost(cached ? Instrumentation::Counts {} : build.finish())
+{
+  if (not cached) {
+    SolutionCache::store(ps, e, method, {tfdh.dv0, tfdh.r, tfdh.phi, integrals, exclusionRadii});
+  }
+}
 
 
 void TfdhIon::printSummaryToFile(const std::string& filename, const std::string& time) const
@@ -77,6 +126,14 @@ void TfdhIon::printSummaryToFile(const std::string& filename, const std::string&
   outfile << "energy from exchanging ions:  " << embeddingEnergies.ni/ps.kt << "\n";
   outfile << "energy from exchanging e-'s:  " << embeddingEnergies.ne/ps.kt << "\n";
 
+  if (Instrumentation::enabled) {
+    outfile << "\n";
+    outfile << "cost of the solution (calls, inclusive time [ms])\n";
+    for (size_t i=0; i<Instrumentation::num_probes; ++i) {
+      outfile << Instrumentation::names[i] << " = " << cost.calls[i] << ", " << 1e-6*cost.ns[i] << "\n";
+    }
+  }
+
   return;
 }
 
@@ -100,38 +157,107 @@ void TfdhIon::printRadialProfileToFile(const std::string& filename, const std::s
   outfile << "# col #6 = enclosed net charge in units of q_e\n";
   outfile << "# col #7 = enclosed bound electron charge in units of q_e\n";
 
-  // needed for cumulative distribution output
-  const auto f_charge = [&] (const double r) -> double {
-    return Plasma::totalIonChargeDensity(tfdh(r), ps) - Plasma::ne(tfdh(r), ps);
-  };
-  const auto f_nb = [&] (const double r) -> double {
-    return Plasma::neBound(tfdh(r), ps);
-  };
-  double accumulate_charge = 0;
-  double accumulate_numbound = 0;
-
   // print profiles:
+  const std::vector<std::vector<double>> columns = radialProfileColumns();
   const std::string sep = "    ";
   for (size_t i=0; i<tfdh.r.size(); ++i) {
+    for (size_t c=0; c<columns.size(); ++c) {
+      outfile << (c > 0 ? sep : "") << columns[c][i];
+    }
+    outfile << "\n";
+  }
+
+  return;
+}
+
+
+void TfdhIon::writeSummaryToBinaryFile(const std::string& filename, const std::string& time) const
+{
+  Columnar::Table table = plasmaParameters(time);
+  table.scalars.push_back({"rws", Plasma::radiusWignerSeitz(e, ps)});
+  table.scalars.push_back({"number_bound_electrons", numberBoundElectrons});
+  table.scalars.push_back({"z_net", e.Z - numberBoundElectrons});
+  // the embedding energy and its breakdown, in units of kT
+  table.scalars.push_back({"embedding_energy", embeddingEnergies.total/ps.kt});
+  table.scalars.push_back({"ion_field_energy", embeddingEnergies.fi/ps.kt});
+  table.scalars.push_back({"e_field_energy", embeddingEnergies.fe/ps.kt});
+  table.scalars.push_back({"field_energy_overcounting", embeddingEnergies.f2/ps.kt});
+  table.scalars.push_back({"ion_kinetic_energy_change", embeddingEnergies.ki/ps.kt});
+  table.scalars.push_back({"e_kinetic_energy_change", embeddingEnergies.ke/ps.kt});
+  table.scalars.push_back({"ion_exchange_energy", embeddingEnergies.ni/ps.kt});
+  table.scalars.push_back({"e_exchange_energy", embeddingEnergies.ne/ps.kt});
+  if (Instrumentation::enabled) {
+    for (size_t i=0; i<Instrumentation::num_probes; ++i) {
+      const std::string name = Instrumentation::names[i];
+      table.scalars.push_back({"calls_" + name, static_cast<double>(cost.calls[i])});
+      table.scalars.push_back({"ns_" + name, static_cast<double>(cost.ns[i])});
+    }
+  }
+  table.columnNames = {"rex"};
+  table.columns = {exclusionRadii};
+  Columnar::write(filename, table);
+}
+
+
+void TfdhIon::writeRadialProfileToBinaryFile(const std::string& filename, const std::string& time) const
+{
+  Columnar::Table table = plasmaParameters(time);
+  // the same columns as in printRadialProfileToFile
+  table.columnNames = {"radius", "potential", "ne", "ne_bound", "ne_free",
+    "ion_charge_density", "enclosed_net_charge", "enclosed_bound_electrons"};
+  table.columns = radialProfileColumns();
+  Columnar::write(filename, table);
+}
+
+
+Columnar::Table TfdhIon::plasmaParameters(const std::string& time) const
+{
+  std::ostringstream composition;
+  composition << ps.comp;
+
+  Columnar::Table table;
+  table.text = {{"time", time}, {"central_ion", e.name}, {"composition", composition.str()}};
+  table.scalars = {{"Z", static_cast<double>(e.Z)}, {"A", static_cast<double>(e.A)}, {"rho", ps.rho},
+    {"t", ps.kt / PhysicalConstantsCGS::KBoltzmann}, {"ne", ps.ne},
+    {"tau", ps.tau}, {"chi", ps.chi}, {"is_relativistic", ps.isRelativistic ? 1.0 : 0.0}};
+  for (size_t i=0; i<ps.ni.size(); ++i) {
+    table.scalars.push_back({"ni[" + std::to_string(i) + "]", ps.ni[i]});
+  }
+  return table;
+}
+
+
+std::vector<std::vector<double>> TfdhIon::radialProfileColumns() const
+{
+  const size_t n = tfdh.r.size();
+  std::vector<std::vector<double>> columns(8, std::vector<double>(n));
+
+  // the enclosed net charge and bound electrons, for the cumulative columns
+  const auto f_enclosed = [&] (const double r) -> std::array<double, 2> {
+    const double phi = tfdh(r);
+    return {{Plasma::totalIonChargeDensity(phi, ps) - Plasma::ne(phi, ps),
+      Plasma::neBound(phi, ps)}};
+  };
+  const std::vector<std::array<double, 2>> enclosed = cumulativeIntegralOverRadius<2>(f_enclosed, tfdh.r);
+
+  for (size_t i=0; i<n; ++i) {
     // columns 0,1 -- the tfdh (r,phi) results
-    outfile << tfdh.r[i] << sep << tfdh.phi[i];
+    columns[0][i] = tfdh.r[i];
+    columns[1][i] = tfdh.phi[i];
 
     // columns 2,3,4 -- the electron densities
     const double ne = Plasma::ne(tfdh.phi[i], ps);
     const double neb = Plasma::neBound(tfdh.phi[i], ps);
-    outfile << sep << ne << sep << neb << sep << ne-neb;
+    columns[2][i] = ne;
+    columns[3][i] = neb;
+    columns[4][i] = ne-neb;
 
     // column 5 -- ion charge density
-    outfile << sep << Plasma::totalIonChargeDensity(tfdh.phi[i], ps);
+    columns[5][i] = Plasma::totalIonChargeDensity(tfdh.phi[i], ps);
 
     // columns 6,7 -- the cumulative distributions
-    if (i > 0) {
-      accumulate_charge += integrateOverRadius(f_charge, tfdh.r[i-1], tfdh.r[i]);
-      accumulate_numbound += integrateOverRadius(f_nb, tfdh.r[i-1], tfdh.r[i]);
-    }
-    outfile << sep << e.Z + accumulate_charge << sep << accumulate_numbound;
-    outfile << "\n";
+    columns[6][i] = e.Z + enclosed[i][0];
+    columns[7][i] = enclosed[i][1];
   }
-
-  return;
+  return columns;
 }
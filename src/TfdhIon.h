@@ -2,27 +2,59 @@
 #ifndef TFDH_TFDH_ION_H
 #define TFDH_TFDH_ION_H
 
+#include "ColumnarFile.h"
 #include "Element.h"
+#include "Instrumentation.h"
 #include "PlasmaState.h"
+#include "SolutionCache.h"
+#include "TfdhBvpSolve.h"
 #include "TfdhFunctions.h"
+#include "TfdhOdeSolve.h"
 #include "TfdhSolution.h"
 
+#include <memory>
+#include <string>
 #include <vector>
 
 
+// the solution is read from the SolutionCache if it holds this point, and
+// stored to it otherwise. it is found by the given TFDH::Method: by the
+// shooting, unless its shot isn't neutral, or by relaxation
 class TfdhIon {
   public:
-    TfdhIon(const PlasmaState& plasmaState, const Element& element);
+    TfdhIon(const PlasmaState& plasmaState, const Element& element,
+        TFDH::Method method=TFDH::Method::Shooting);
+    // warm start from a guess of the shooting parameter, see TFDH::solve
+    // (relaxation doesn't use it)
+    TfdhIon(const PlasmaState& plasmaState, const Element& element, double dv0Guess,
+        TFDH::Method method=TFDH::Method::Shooting);
 
     void printSummaryToFile(const std::string& filename, const std::string& time="<no time given>") const;
     void printRadialProfileToFile(const std::string& filename, const std::string& time="<no time given>") const;
 
+    // the same contents in the binary format of ColumnarFile.h, at full
+    // precision; the plasma parameters are stored as named scalars
+    void writeSummaryToBinaryFile(const std::string& filename, const std::string& time="<no time given>") const;
+    void writeRadialProfileToBinaryFile(const std::string& filename, const std::string& time="<no time given>") const;
+
     const PlasmaState ps;
     const Element e;
     const TfdhSolution tfdh;
+    const TFDH::SolutionIntegrals integrals;
     const double numberBoundElectrons;
     const TFDH::EnergyDeltas embeddingEnergies;
     const std::vector<double> exclusionRadii;
+    // what solving this ion took on the calling thread (zero for one read
+    // from the cache, and in builds without instrumentation)
+    const Instrumentation::Counts cost;
+
+  private:
+    Columnar::Table plasmaParameters(const std::string& time) const;
+    std::vector<std::vector<double>> radialProfileColumns() const;
+
+    TfdhIon(const PlasmaState& plasmaState, const Element& element, double dv0Guess,
+        TFDH::Method method, const Instrumentation::Region& build,
+        std::unique_ptr<const SolutionCache::Entry> cached);
 };
 
 
@@ -2,99 +2,418 @@
 #include "TfdhOdeSolve.h"
 
 #include "Element.h"
+#include "Instrumentation.h"
+#include "IntegrateOverRadius.h"
+#include "ObjectPool.h"
+#include "ParallelFor.h"
 #include "PhysicalConstants.h"
 #include "PlasmaFunctions.h"
 #include "PlasmaState.h"
 #include "TfdhSolution.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_odeiv2.h>
+#include <utility>
 #include <vector>
 
 
 namespace {
 
+  // first step away from a warm-start guess of dv0, relative to the guess
+  const double warm_start_step = 1e-2;
+
+  // the Newton search for dv0 stops when its steps are below this, relative
+  // to dv0 (see findPotentialRootNewton): within a few thousand ulps of the
+  // boundary the bisection finds, so that the trajectory follows the
+  // screened tail about as far out
+  const double newton_tolerance = 1e-12;
+
+  // what is integrated along with the ODE itself: nothing; the sensitivities
+  // to dv0; or those and the global integrals of the solution (see
+  // TFDH::integrals)
+  enum class Extras {None, Sensitivity, SensitivityAndIntegrals};
+
+  const size_t max_dim = 12;
+
+  // the largest step of the integration, relative to the radius
+  const double max_dr_over_r = 0.2;
+
+  // the same in s = ln r (see logRadiusRhs)
+  const double max_ds = 0.5;
+
+  // the independent variable of the integrations of TFDH::solve. ln r is
+  // opt-in (see TFDH::integrateTrajectory) until it has been timed with
+  // GSL's rk8pd
+  const TFDH::Coordinate default_coordinate = TFDH::Coordinate::Radius;
+
+  // the implicit stepper is chosen when the step cap at the ion sphere spans
+  // more screening lengths than this (see TFDH::chooseStepper). it is yet to
+  // be set from timings of GSL's two steppers; until then it is above the
+  // ratio's value anywhere in rho <= 1e10, T >= 1e5 (~160, for carbon), so
+  // that those states keep the explicit stepper of the baseline
+  const double stiffness_threshold = 200.0;
+
   struct IntegrationResults {
-    const std::vector<double> rs;
-    const std::vector<double> phis;
+    std::vector<double> rs;
+    std::vector<double> phis;
+    // the ODE state at the last radius: f[0], f[1], then the extras
+    std::array<double, max_dim> last;
+    Extras extras;
+  };
+
+  // the outcome of the search for the shooting parameter: dv0, and the
+  // trajectory integrated with it. the search always ends on a dv0 it has
+  // already integrated (one end of the final bracket), and keeps the
+  // trajectories at both ends of its bracket, so the solution is never
+  // integrated a second time
+  struct Shot {
+    double dv0;
+    IntegrationResults tfdh;
   };
 
+  // ODE integration bounds
+  double initialRadius(const Element& e, const PlasmaState& p) {
+    return 1e-4 * Plasma::radiusWignerSeitz(e, p);
+  }
+  double finalRadius(const Element& e, const PlasmaState& p) {
+    return 1e3 * Plasma::radiusWignerSeitz(e, p);
+  }
+
   struct RhsParams {
     const PlasmaState& p;
+    const Element& e;
+    // background densities, for the integrals
+    const double ni0;
+    const double ke0;
   };
 
 
+  // the poisson equation for f = {r phi/qe, d/dr r phi/qe}
+  void poissonRhs(const double r, const double f[], double dfdr[], const PlasmaState& p) {
+    const double& qe = PhysicalConstantsCGS::ElectronCharge;
+    const double phi = qe*f[0]/r;
+    const double ne = Plasma::ne(phi, p);
+    const double ionChargeDensity = Plasma::totalIonChargeDensity(phi, p);
+    dfdr[0] = f[1];
+    dfdr[1] = -4.0*M_PI*qe * r * (ionChargeDensity - ne);
+  }
+
+  // the three right-hand sides below each count as one tfdhOdeRhs call
   int tfdhOdeRhs(const double r, const double f[], double dfdr[], void *params) {
+    const Instrumentation::SampledTimer timer(Instrumentation::Probe::OdeRhs);
+    poissonRhs(r, f, dfdr, static_cast<RhsParams*>(params)->p);
+    return GSL_SUCCESS;
+  }
+
+  // the ODE above extended by its variational equations: f[2], f[3] are the
+  // derivatives of f[0], f[1] with respect to the shooting parameter dv0
+  int tfdhOdeRhsWithSensitivity(const double r, const double f[], double dfdr[], void *params) {
+    const Instrumentation::SampledTimer timer(Instrumentation::Probe::OdeRhs);
+    poissonRhs(r, f, dfdr, static_cast<RhsParams*>(params)->p);
     const double& qe = PhysicalConstantsCGS::ElectronCharge;
     const double phi = qe*f[0]/r;
     const PlasmaState& p = static_cast<RhsParams*>(params)->p;
+    const double dChargeDensity = Plasma::dTotalIonChargeDensityDphi(phi, p) - Plasma::dneDphi(phi, p);
+    dfdr[2] = f[3];
+    dfdr[3] = -4.0*M_PI*qe*qe * dChargeDensity * f[2];
+    return GSL_SUCCESS;
+  }
+
+  // the ODE with its variational equations as above, further extended by the
+  // radial integrals of TFDH::SolutionIntegrals as f[4] to f[11], in the
+  // order: bound electrons, net charge, then the integrands of
+  // TFDH::embeddingEnergy (ion field, e- field, overcounting, ion number,
+  // e- kinetic energy, e- number)
+  const size_t num_integrals = 8;
+
+  int tfdhOdeRhsWithIntegrals(const double r, const double f[], double dfdr[], void *params) {
+    const Instrumentation::SampledTimer timer(Instrumentation::Probe::OdeRhs);
+    const double& qe = PhysicalConstantsCGS::ElectronCharge;
+    const double phi = qe*f[0]/r;
+    const RhsParams& rp = *static_cast<RhsParams*>(params);
+    const PlasmaState& p = rp.p;
     const double ne = Plasma::ne(phi, p);
     const double ionChargeDensity = Plasma::totalIonChargeDensity(phi, p);
+    const double dChargeDensity = Plasma::dTotalIonChargeDensityDphi(phi, p) - Plasma::dneDphi(phi, p);
     dfdr[0] = f[1];
     dfdr[1] = -4.0*M_PI*qe * r * (ionChargeDensity - ne);
+    dfdr[2] = f[3];
+    dfdr[3] = -4.0*M_PI*qe*qe * dChargeDensity * f[2];
+
+    const double jacobian = 4.0*M_PI*r*r;
+    const double phi_ext = rp.e.A * qe * qe / r;
+    dfdr[4] = jacobian * Plasma::neBound(phi, p);
+    dfdr[5] = jacobian * (ionChargeDensity - ne);
+    dfdr[6] = jacobian * phi * ionChargeDensity;
+    dfdr[7] = jacobian * (- phi * ne);
+    dfdr[8] = jacobian * 0.5 * (ionChargeDensity - ne) * (phi_ext - phi);
+    dfdr[9] = jacobian * (Plasma::totalIonDensity(phi, p) - rp.ni0);
+    dfdr[10] = jacobian * (Plasma::electronKineticEnergyDensity(phi, p) - rp.ke0);
+    dfdr[11] = jacobian * (ne - p.ne);
     return GSL_SUCCESS;
   }
 
 
+  // the Jacobian of the three right-hand sides above, for the implicit
+  // stepper: dfdy[i*dim + j] = d dfdr[i] / d f[j], and dfdt = d dfdr / dr.
+  // with C = d(ion charge density - ne)/d phi, the Poisson equation gives
+  //   d dfdr[1] / d f[0] = -4 pi qe^2 C
+  //   d dfdr[1] / d r = -4 pi qe (ion charge density - ne - C phi)
+  // of the extras, only the dependence of the sensitivities on themselves is
+  // kept: the rest needs second derivatives of the densities (or of the
+  // integrands), and the extras don't feed back into f[0], f[1], which so
+  // take exactly the same steps as without them
+  template <size_t dim>
+  int tfdhOdeJacobian(const double r, const double f[], double* dfdy, double dfdt[], void *params) {
+    const double& qe = PhysicalConstantsCGS::ElectronCharge;
+    const double phi = qe*f[0]/r;
+    const PlasmaState& p = static_cast<RhsParams*>(params)->p;
+    const double chargeDensity = Plasma::totalIonChargeDensity(phi, p) - Plasma::ne(phi, p);
+    const double dChargeDensity = Plasma::dTotalIonChargeDensityDphi(phi, p) - Plasma::dneDphi(phi, p);
+
+    std::fill(dfdy, dfdy + dim*dim, 0.0);
+    std::fill(dfdt, dfdt + dim, 0.0);
+    dfdy[0*dim + 1] = 1.0;
+    dfdy[1*dim + 0] = -4.0*M_PI*qe*qe * dChargeDensity;
+    dfdt[1] = -4.0*M_PI*qe * (chargeDensity - dChargeDensity * phi);
+    if (dim >= 4) {
+      dfdy[2*dim + 3] = 1.0;
+      dfdy[3*dim + 2] = -4.0*M_PI*qe*qe * dChargeDensity;
+    }
+    return GSL_SUCCESS;
+  }
+
+
+  // the ODE in s = ln r. its state y holds u = f[0] and w = r f[1] = du/ds,
+  // both divided by the scale Z qe of u so they're of order 1 under the
+  // error control; then the sensitivities (unscaled) in the same way; or the
+  // integrals, as they are. the right-hand side follows from the one in r:
+  //   dy[0]/ds = y[1],  dy[1]/ds = y[1] + r^2 f''/(Z qe)
+  // and dI/ds = r dI/dr for an integral I
+  void fromLogRadius(const double r, const double y[], double f[], const size_t dim, const double scale) {
+    std::copy(y, y+dim, f);
+    f[0] = scale*y[0];
+    f[1] = scale*y[1]/r;
+    if (dim >= 4) f[3] = y[3]/r;
+  }
+
+  void toLogRadius(const double r, const double f[], double y[], const size_t dim, const double scale) {
+    std::copy(f, f+dim, y);
+    y[0] = f[0]/scale;
+    y[1] = r*f[1]/scale;
+    if (dim >= 4) y[3] = r*f[3];
+  }
+
+  double scaleOfU(const RhsParams& params) {
+    return PhysicalConstantsCGS::ElectronCharge * params.e.Z;
+  }
+
+  template <size_t dim, int (*rhsInRadius)(double, const double[], double[], void*)>
+  int logRadiusRhs(const double s, const double y[], double dyds[], void *params) {
+    const double r = exp(s);
+    const double scale = scaleOfU(*static_cast<RhsParams*>(params));
+    double f[dim], dfdr[dim];
+    fromLogRadius(r, y, f, dim, scale);
+    rhsInRadius(r, f, dfdr, params);
+    dyds[0] = y[1];
+    dyds[1] = y[1] + r*r*dfdr[1]/scale;
+    if (dim >= 4) {
+      dyds[2] = y[3];
+      dyds[3] = y[3] + r*r*dfdr[3];
+    }
+    for (size_t i=4; i<dim; ++i) dyds[i] = r*dfdr[i];
+    return GSL_SUCCESS;
+  }
+
+  // the Jacobian of logRadiusRhs, from that in r as above:
+  //   d dy[1]/ds / d y[0] = r^2 d dfdr[1] / d f[0]
+  //   d dy[1]/ds / d s = -4 pi qe r^3 (3 (ion charge density - ne) - C phi) / (Z qe)
+  template <size_t dim>
+  int logRadiusJacobian(const double s, const double y[], double* dfdy, double dfdt[], void *params) {
+    const double r = exp(s);
+    const double scale = scaleOfU(*static_cast<RhsParams*>(params));
+    double f[dim];
+    fromLogRadius(r, y, f, dim, scale);
+    const double& qe = PhysicalConstantsCGS::ElectronCharge;
+    const double phi = qe*f[0]/r;
+    const PlasmaState& p = static_cast<RhsParams*>(params)->p;
+    const double chargeDensity = Plasma::totalIonChargeDensity(phi, p) - Plasma::ne(phi, p);
+    const double dChargeDensity = Plasma::dTotalIonChargeDensityDphi(phi, p) - Plasma::dneDphi(phi, p);
+
+    std::fill(dfdy, dfdy + dim*dim, 0.0);
+    std::fill(dfdt, dfdt + dim, 0.0);
+    dfdy[0*dim + 1] = 1.0;
+    dfdy[1*dim + 0] = -4.0*M_PI*qe*qe * dChargeDensity * r*r;
+    dfdy[1*dim + 1] = 1.0;
+    dfdt[1] = -4.0*M_PI*qe * r*r*r * (3*chargeDensity - dChargeDensity * phi) / scale;
+    if (dim >= 4) {
+      dfdy[2*dim + 3] = 1.0;
+      dfdy[3*dim + 2] = -4.0*M_PI*qe*qe * dChargeDensity * r*r;
+      dfdy[3*dim + 3] = 1.0;
+    }
+    return GSL_SUCCESS;
+  }
+
+
+  // the GSL objects of one integration, allocated for a dimension of the ODE
+  struct OdeWorkspace {
+    gsl_odeiv2_evolve* ev;
+    gsl_odeiv2_control* ctrl;
+    gsl_odeiv2_step* step;
+  };
+
+  void freeOdeWorkspace(OdeWorkspace* ws) {
+    gsl_odeiv2_step_free(ws->step);
+    gsl_odeiv2_control_free(ws->ctrl);
+    gsl_odeiv2_evolve_free(ws->ev);
+    delete ws;
+  }
+
+  // each thread recycles its own workspaces, one pool per stepper,
+  // coordinate and dimension (which also fix the tolerance and error scales
+  // of the control); see ObjectPool.h
+  thread_local ObjectPool<OdeWorkspace, freeOdeWorkspace> odeWorkspaces[2][2][max_dim+1];
+
+
+  // takes its GSL objects from the calling thread's pool, so may be called
+  // from several threads at once
   IntegrationResults integrateODE(const Element& e, const PlasmaState& p,
-      const double r_init, const double r_final, const double dv0)
+      const double r_init, const double r_final, const double dv0,
+      const Extras extras, const TFDH::Stepper stepper, const TFDH::Coordinate coordinate)
   {
-    const double eps_abs = 1e-6;
+    const Instrumentation::ScopedTimer timer(Instrumentation::Probe::IntegrateOde);
+    const bool logRadius = (coordinate == TFDH::Coordinate::LogRadius);
+    // on f[0], f[1] in r, or on y[0], y[1] in ln r, which are of order 1
+    const double eps_abs = logRadius ? 1e-7 : 1e-6;
     const double eps_rel = 0;
     const double& qe = PhysicalConstantsCGS::ElectronCharge;
-    const size_t dim = 2;
-    double solution[dim] = {qe*e.Z + r_init*dv0, dv0};
-    RhsParams params {p};
+    const bool withIntegrals = (extras == Extras::SensitivityAndIntegrals);
+    const size_t dim = withIntegrals ? 4 + num_integrals : ((extras == Extras::Sensitivity) ? 4 : 2);
+    double solution[max_dim] = {qe*e.Z + r_init*dv0, dv0};
+    if (dim >= 4) {
+      solution[2] = r_init;
+      solution[3] = 1.0;
+    }
+    RhsParams params {p, e,
+      withIntegrals ? Plasma::totalIonDensity(0.0, p) : 0.0,
+      withIntegrals ? Plasma::electronKineticEnergyDensity(0.0, p) : 0.0};
 
-    gsl_odeiv2_evolve* ev = gsl_odeiv2_evolve_alloc(dim);
-    gsl_odeiv2_control* ctrl = gsl_odeiv2_control_y_new(eps_abs, eps_rel);
-    gsl_odeiv2_step* step = gsl_odeiv2_step_alloc(gsl_odeiv2_step_rk8pd, dim);
-    gsl_odeiv2_system sys = {tfdhOdeRhs, nullptr, dim, &params};
+    // the extras are left out of the error control (by giving them a huge
+    // tolerance) so that f[0], f[1] take the same steps as without them: the
+    // kinds of integrations agree on where the solution diverges
+    double scale_abs[max_dim];
+    std::fill(scale_abs, scale_abs+max_dim, 1e300);
+    scale_abs[0] = scale_abs[1] = 1.0;
+
+    const bool implicit = (stepper == TFDH::Stepper::Implicit);
+    const auto workspace = odeWorkspaces[implicit][logRadius][dim].acquire([&] {
+      return new OdeWorkspace {gsl_odeiv2_evolve_alloc(dim),
+        gsl_odeiv2_control_scaled_new(eps_abs, eps_rel, 1.0, 0.0, scale_abs, dim),
+        gsl_odeiv2_step_alloc(implicit ? gsl_odeiv2_step_bsimp : gsl_odeiv2_step_rk8pd, dim)};
+    });
+    gsl_odeiv2_evolve* ev = workspace.get()->ev;
+    gsl_odeiv2_control* ctrl = workspace.get()->ctrl;
+    gsl_odeiv2_step* step = workspace.get()->step;
+    gsl_odeiv2_evolve_reset(ev);
+    gsl_odeiv2_step_reset(step);
+    gsl_odeiv2_system sys = logRadius
+      ? gsl_odeiv2_system {
+        (extras == Extras::Sensitivity) ? logRadiusRhs<4, tfdhOdeRhsWithSensitivity>
+          : (withIntegrals ? logRadiusRhs<4 + num_integrals, tfdhOdeRhsWithIntegrals>
+            : logRadiusRhs<2, tfdhOdeRhs>),
+        not implicit ? nullptr
+          : ((extras == Extras::Sensitivity) ? logRadiusJacobian<4>
+            : (withIntegrals ? logRadiusJacobian<4 + num_integrals> : logRadiusJacobian<2>)),
+        dim, &params}
+      : gsl_odeiv2_system {
+        (extras == Extras::Sensitivity) ? tfdhOdeRhsWithSensitivity
+          : (withIntegrals ? tfdhOdeRhsWithIntegrals : tfdhOdeRhs),
+        not implicit ? nullptr
+          : ((extras == Extras::Sensitivity) ? tfdhOdeJacobian<4>
+            : (withIntegrals ? tfdhOdeJacobian<4 + num_integrals> : tfdhOdeJacobian<2>)),
+        dim, &params};
 
     // vectors in which to store (r,phi) at each step
     std::vector<double> rs = {r_init};
     std::vector<double> phis = {qe*solution[0]/r_init};
 
+    // the integration runs in t = r or t = s over the state y = f or y as
+    // in logRadiusRhs; f is kept up to date with y
+    const double scale = scaleOfU(params);
+    double y[max_dim];
+    if (logRadius) toLogRadius(r_init, solution, y, dim, scale);
+    else std::copy(solution, solution+max_dim, y);
+    double t = logRadius ? log(r_init) : r_init;
+    const double t_final = logRadius ? log(r_final) : r_final;
+    double dt = logRadius ? max_ds : r_init;
     double r = r_init;
-    double dr = r_init;
-    const double max_dr_over_r = 0.2;
-    while (r < r_final) {
-      dr = fmin(dr, max_dr_over_r * r); // prevent dr from being "too big"
-      const int status = gsl_odeiv2_evolve_apply(ev, ctrl, step, &sys, &r, r_final, &dr, solution);
+    while (t < t_final) {
+      // prevent the step from being "too big"
+      dt = logRadius ? fmin(dt, max_ds) : fmin(dt, max_dr_over_r * t);
+      const int status = gsl_odeiv2_evolve_apply(ev, ctrl, step, &sys, &t, t_final, &dt, y);
       assert(status==GSL_SUCCESS);
+      r = logRadius ? exp(t) : t;
+      if (logRadius) fromLogRadius(r, y, solution, dim, scale);
+      else std::copy(y, y+max_dim, solution);
       rs.push_back(r);
       phis.push_back(qe*solution[0]/r);
       if (solution[0] <= 0 or (solution[1]-solution[0])/r > 0) break;
     }
-    assert(r < r_final and "integrated ODE until final radius without terminating!");
+    assert(t < t_final and "integrated ODE until final radius without terminating!");
+
+    IntegrationResults results {rs, phis, {}, extras};
+    std::copy(solution, solution+max_dim, results.last.begin());
+    return results;
+  }
 
-    gsl_odeiv2_step_free(step);
-    gsl_odeiv2_control_free(ctrl);
-    gsl_odeiv2_evolve_free(ev);
-    return {rs, phis};
+  // with the stepper chosen for the state, in the default coordinate
+  IntegrationResults integrateODE(const Element& e, const PlasmaState& p,
+      const double r_init, const double r_final, const double dv0,
+      const Extras extras=Extras::None)
+  {
+    return integrateODE(e, p, r_init, r_final, dv0, extras, TFDH::chooseStepper(e, p),
+        default_coordinate);
   }
 
 
-  double findPotentialRoot(const Element& e, const PlasmaState& p,
-      const double r_init, const double r_final)
+  Shot findPotentialRootBisection(const Element& e, const PlasmaState& p,
+      const double r_init, const double r_final, const double v_guess)
   {
-    // find interval that brackets correct potential
-    double v_low = 0;
-    double v_high = 0;
+    // find interval that brackets correct potential, by walking away from the
+    // guess until the solution diverges the other way. from a cold start (a
+    // guess of 0, which is too high) the walk is in fixed steps; from a warm
+    // start it begins with small steps, since the guess should be close
+    double v_low = v_guess;
+    double v_high = v_guess;
+    IntegrationResults tfdh_low, tfdh_high;
     {
+      const bool cold = (v_guess == 0);
+      double v_step = cold ? 100.0 : warm_start_step * fabs(v_guess);
+      const double growth = cold ? 1.0 : 2.0;
+
+      double v = v_guess;
+      IntegrationResults tfdh = integrateODE(e, p, r_init, r_final, v);
+      const bool walk_up = tfdh.phis.back() < 0.0;
       bool success = false;
-      const double v_step = 100.0;
       const int bracket_attempts = 100;
       for (int i=0; i<bracket_attempts; ++i) {
-        const auto& tfdh = integrateODE(e, p, r_init, r_final, v_low);
-        if (tfdh.phis.back() < 0.0) {
+        // the last trial becomes the trailing end of the bracket
+        (walk_up ? v_low : v_high) = v;
+        (walk_up ? tfdh_low : tfdh_high) = std::move(tfdh);
+
+        v += walk_up ? v_step : -v_step;
+        tfdh = integrateODE(e, p, r_init, r_final, v);
+        if ((tfdh.phis.back() < 0.0) != walk_up) {
+          (walk_up ? v_high : v_low) = v;
+          (walk_up ? tfdh_high : tfdh_low) = std::move(tfdh);
           success = true;
           break;
         }
-        v_high = v_low;
-        v_low -= v_step;
+        v_step *= growth;
       }
       assert(success and "failed to bracket potential root");
     }
@@ -113,30 +432,294 @@ namespace {
           break;
         }
 
-        const auto& tfdh = integrateODE(e, p, r_init, r_final, v_mid);
-        ((tfdh.phis.back() >= 0.0) ? v_high : v_low) = v_mid;
+        IntegrationResults tfdh = integrateODE(e, p, r_init, r_final, v_mid);
+        if (tfdh.phis.back() >= 0.0) {
+          v_high = v_mid;
+          tfdh_high = std::move(tfdh);
+        } else {
+          v_low = v_mid;
+          tfdh_low = std::move(tfdh);
+        }
       }
       assert(success and "failed to find potential root within bracket");
     }
 
-    return v_mid;
+    return {v_mid, std::move((v_mid==v_low) ? tfdh_low : tfdh_high)};
+  }
+
+
+  // Same boundary as findPotentialRootBisection, but in rounds of numThreads
+  // trial dv0's that are integrated concurrently: spread out from the guess
+  // until the root is bracketed, then at the points dividing the bracket into
+  // numThreads+1 equal parts. Each round takes about the wall-clock time of
+  // one integration, and shrinks the bracket numThreads+1-fold instead of 2.
+  //
+  // Each round's outcomes are read in order of increasing dv0, and the bracket
+  // closes around the first trial diverging upwards -- so that, as for the
+  // serial bisection, trials of dv0 too close to the root to give consistent
+  // answers can't leave an inverted bracket.
+  Shot findPotentialRootMultisection(const Element& e, const PlasmaState& p,
+      const double r_init, const double r_final, const double v_guess,
+      unsigned numThreads)
+  {
+    if (numThreads == 0) numThreads = defaultThreadCount();
+    const bool cold = (v_guess == 0);
+    double v_step = cold ? 100.0 : warm_start_step * fabs(v_guess);
+
+    double v_low = 0, v_high = 0;
+    bool have_low = false, have_high = false;
+    IntegrationResults tfdh_low, tfdh_high;
+
+    // the first round is the guess, and either fixed steps below it (from a
+    // cold start, the guess of 0 being too high) or growing steps to both
+    // sides of it
+    std::vector<double> trials = {v_guess};
+    for (unsigned j=1; j<numThreads; ++j) {
+      trials.push_back(cold ? v_guess - j*v_step
+          : v_guess + ((j%2) ? -1 : 1) * ldexp(v_step, (j-1)/2));
+    }
+
+    const int rounds = 200;
+    for (int round=0; round<rounds; ++round) {
+      std::sort(trials.begin(), trials.end());
+      std::vector<IntegrationResults> results(trials.size());
+      const auto integrateTrial = [&] (const size_t i) {
+        results[i] = integrateODE(e, p, r_init, r_final, trials[i]);
+      };
+      parallelFor(trials.size(), integrateTrial, numThreads);
+
+      size_t first_high = 0;
+      while (first_high < trials.size() and results[first_high].phis.back() < 0.0) ++first_high;
+      if (first_high < trials.size()) {
+        v_high = trials[first_high];
+        tfdh_high = std::move(results[first_high]);
+        have_high = true;
+      }
+      if (first_high > 0) {
+        v_low = trials[first_high-1];
+        tfdh_low = std::move(results[first_high-1]);
+        have_low = true;
+      }
+
+      trials.clear();
+      if (have_low and have_high) {
+        const double v_mid = (v_low + v_high)/2.0;
+        if (v_mid==v_low or v_mid==v_high) {
+          return {v_mid, std::move((v_mid==v_low) ? tfdh_low : tfdh_high)};
+        }
+        for (unsigned j=1; j<=numThreads; ++j) {
+          const double v = v_low + (v_high - v_low)*j/(numThreads+1);
+          if (v > v_low and v < v_high and (trials.empty() or v != trials.back())) {
+            trials.push_back(v);
+          }
+        }
+      } else {
+        // keep walking away from the one side known so far
+        const double sign = have_low ? 1.0 : -1.0;
+        const double from = have_low ? v_low : v_high;
+        for (unsigned j=0; j<numThreads; ++j) {
+          trials.push_back(from + sign * (cold ? (j+1)*v_step : ldexp(v_step, j)));
+        }
+        if (not cold) v_step = ldexp(v_step, numThreads);
+      }
+    }
+    assert(false and "failed to find potential root");
+    return {v_high, std::move(tfdh_high)};
+  }
+
+
+  // screening wavenumber k of the linearized Poisson equation far from the
+  // ion, where u = r phi / qe obeys u'' = k^2 u
+  double screeningWavenumber(const PlasmaState& p) {
+    const double& qe = PhysicalConstantsCGS::ElectronCharge;
+    const double dChargeDensity = Plasma::dTotalIonChargeDensityDphi(0.0, p) - Plasma::dneDphi(0.0, p);
+    return sqrt(-4.0*M_PI*qe*qe * dChargeDensity);
+  }
+
+
+  // Same boundary as findPotentialRootBisection, starting from the same guess,
+  // but each trial dv0 proposes
+  // the next by a Newton step on the growing part of the solution.
+  //
+  // Far from the ion u'' = k^2 u, with solutions exp(+-kr). The correct
+  // potential is the purely decaying one, and a wrong dv0 adds a growing part
+  // proportional to (dv0 - dv0_correct). The combination g = u' + k u removes
+  // the decaying part, so g at the end of a trajectory (in the linear regime)
+  // is proportional to (dv0 - dv0_correct) at any radius, and the variational
+  // equations give dg/d(dv0) for a Newton step.
+  //
+  // The Newton steps are safeguarded by the bracket of dv0's known to diverge
+  // to either side: steps leaving the bracket are replaced by bisection, and
+  // consecutive steps landing on the same side are lengthened so the bracket
+  // closes from both ends. Once a step is below newton_tolerance, the next
+  // trials go just past the root estimate to the side not yet known there,
+  // and it stops when the bracket is down to a few times the tolerance --
+  // which, unlike the bisection, doesn't take the steps near the root that
+  // mostly land on one side. It returns the trajectory of the end of the
+  // bracket nearer the root.
+  //
+  // Once the Newton steps are small enough for the next trial to be within
+  // the tolerance, the trials also carry the integrals of TFDH::integrals, so
+  // that the returned trajectory has them (the end nearer the root is chosen
+  // of those that do, if any).
+  Shot findPotentialRootNewton(const Element& e, const PlasmaState& p,
+      const double r_init, const double r_final, const double v_guess)
+  {
+    const double k = screeningWavenumber(p);
+    const bool cold = (v_guess == 0);
+    double v_step = cold ? 100.0 : warm_start_step * fabs(v_guess);
+
+    double v_low = 0, v_high = 0;
+    bool have_low = false, have_high = false;
+    IntegrationResults tfdh_low, tfdh_high;
+    double v = v_guess;
+    double overshoot = 1;
+    bool last_was_low = false;
+    double root = v_guess;
+    bool near_root = false;
+
+    const int attempts = 200;
+    for (int i=0; i<attempts; ++i) {
+      IntegrationResults tfdh = integrateODE(e, p, r_init, r_final, v,
+          near_root ? Extras::SensitivityAndIntegrals : Extras::Sensitivity);
+      const double g = tfdh.last[1] + k*tfdh.last[0];
+      const double dg = tfdh.last[3] + k*tfdh.last[2];
+      const bool is_low = tfdh.phis.back() < 0.0;
+      if (is_low) {
+        v_low = v;
+        tfdh_low = std::move(tfdh);
+        have_low = true;
+      } else {
+        v_high = v;
+        tfdh_high = std::move(tfdh);
+        have_high = true;
+      }
+      overshoot = (i > 0 and is_low == last_was_low) ? 2*overshoot : 1;
+      last_was_low = is_low;
+
+      const bool converged = fabs(g/dg) <= newton_tolerance * fabs(v);
+      if (converged) root = v - g/dg;
+      // after a step this small, the next lands within the tolerance
+      near_root = near_root or fabs(g/dg) <= sqrt(newton_tolerance) * fabs(v);
+      const double delta = newton_tolerance * fabs(root);
+      if (have_low and have_high) {
+        const double v_mid = (v_low + v_high)/2.0;
+        if (v_high - v_low <= 4*delta or v_mid==v_low or v_mid==v_high) {
+          const bool low_has_integrals = (tfdh_low.extras == Extras::SensitivityAndIntegrals);
+          const bool high_has_integrals = (tfdh_high.extras == Extras::SensitivityAndIntegrals);
+          const bool low_is_nearer = (low_has_integrals != high_has_integrals) ? low_has_integrals
+            : fabs(v_low - root) <= fabs(v_high - root);
+          return low_is_nearer ? Shot {v_low, std::move(tfdh_low)} : Shot {v_high, std::move(tfdh_high)};
+        }
+      }
+
+      double next = converged ? (is_low ? std::max(root, v) + delta : std::min(root, v) - delta)
+        : v - overshoot * g/dg;
+      if (have_low and have_high) {
+        if (not (next > v_low and next < v_high)) next = (v_low + v_high)/2.0;
+      } else if (not (have_high ? next < v_high : next > v_low)) {
+        // (a guess that is far off may need several fallback steps)
+        next = have_high ? v_high - v_step : v_low + v_step;
+        if (not cold) v_step *= 2;
+      }
+      v = next;
+    }
+    assert(false and "failed to find potential root");
+    return {v, std::move(tfdh_high)};
   }
 }
 
 
 
-TfdhSolution TFDH::solve(const Element& e, const PlasmaState& p)
+TFDH::Stepper TFDH::chooseStepper(const Element& e, const PlasmaState& p)
 {
-  // ODE integration bounds
-  const double rws = Plasma::radiusWignerSeitz(e,p);
-  const double ri = 1e-4 * rws;
-  const double rf = 1e3 * rws;
-
-  // NOTE: with this setup, the "correct" ODE is integrated twice -- first while
-  // finding the correct potential, then again using the correct potential.
-  // this should be a negligible cost, but could be optimized away if need be.
-  const double dv0 = findPotentialRoot(e, p, ri, rf);
-  const IntegrationResults& results = integrateODE(e, p, ri, rf, dv0);
-  return TfdhSolution(results.rs, results.phis);
+  // the linearized ODE is a saddle, with modes growing and decaying as
+  // exp(+-k r) for k the inverse screening length. the explicit stepper must
+  // resolve them wherever the solution is more than flat, so it can only run
+  // into its stability limit if the step cap lets it take many screening
+  // lengths at once.
+  //
+  // k of the background, from the linearized Poisson equation at phi = 0
+  const double& qe = PhysicalConstantsCGS::ElectronCharge;
+  const double dChargeDensity = Plasma::dTotalIonChargeDensityDphi(0.0, p) - Plasma::dneDphi(0.0, p);
+  const double k = sqrt(4.0*M_PI*qe*qe * fabs(dChargeDensity));
+  const double stepAtIonSphere = max_dr_over_r * Plasma::radiusWignerSeitz(e, p);
+  return (k * stepAtIonSphere > stiffness_threshold) ? Stepper::Implicit : Stepper::Explicit;
+}
+
+
+
+TfdhSolution TFDH::solve(const Element& e, const PlasmaState& p, const Shooting method,
+    const unsigned numThreads)
+{
+  return solve(e, p, 0.0, method, numThreads);
+}
+
+
+TfdhSolution TFDH::solve(const Element& e, const PlasmaState& p,
+    const TfdhSolution& prior, const Shooting method, const unsigned numThreads)
+{
+  return solve(e, p, prior.dv0, method, numThreads);
+}
+
+
+TfdhSolution TFDH::solve(const Element& e, const PlasmaState& p, const double dv0Guess,
+    const Shooting method, const unsigned numThreads)
+{
+  const Instrumentation::ScopedTimer timer(Instrumentation::Probe::FindPotentialRoot);
+  const double ri = initialRadius(e, p);
+  const double rf = finalRadius(e, p);
+  const Shot shot =
+    (method == Shooting::Newton) ? findPotentialRootNewton(e, p, ri, rf, dv0Guess)
+    : (method == Shooting::Multisection) ? findPotentialRootMultisection(e, p, ri, rf, dv0Guess, numThreads)
+    : findPotentialRootBisection(e, p, ri, rf, dv0Guess);
+  const bool withIntegrals = (shot.tfdh.extras == Extras::SensitivityAndIntegrals);
+  const auto integrals = shot.tfdh.last.begin() + 4;
+  return TfdhSolution(shot.tfdh.rs, shot.tfdh.phis, shot.dv0,
+      withIntegrals ? std::vector<double>(integrals, integrals + num_integrals) : std::vector<double>());
+}
+
+
+
+TFDH::SolutionIntegrals TFDH::integrals(const TfdhSolution& tfdh, const Element& e,
+    const PlasmaState& p)
+{
+  if (tfdh.trajectoryIntegrals.empty()) {
+    const auto f_charge = [&] (const double r) -> std::array<double, 1> {
+      const double phi = tfdh(r);
+      return {{Plasma::totalIonChargeDensity(phi, p) - Plasma::ne(phi, p)}};
+    };
+    const double charge = integrateOverRadius<1>(f_charge, tfdh.r)[0];
+    return {boundElectrons(tfdh, p), e.Z + charge, embeddingEnergy(tfdh, e, p)};
+  }
+  assert(tfdh.trajectoryIntegrals.size() == num_integrals);
+  const std::vector<double>& f = tfdh.trajectoryIntegrals;
+
+  // combined as in TFDH::embeddingEnergy
+  const double ke0 = Plasma::electronKineticEnergyDensity(0.0, p);
+  const double fi = f[2];
+  const double fe = f[3];
+  const double f2 = f[4];
+  const double ki = 1.5 * p.kt * f[5];
+  const double ke = f[6];
+  const double dni = ki;
+  const double dne = (ke0 / p.ne) * f[7];
+  return {f[0], e.Z + f[1], {fi, fe, f2, ki, ke, dni, dne, fi+fe+f2+ki+ke-dni-dne}};
 }
 
+
+
+void TFDH::odeRhs(const Element& e, const PlasmaState& p, const double r,
+    const double f[2], double dfdr[2])
+{
+  RhsParams params {p, e, 0.0, 0.0};
+  tfdhOdeRhs(r, f, dfdr, &params);
+}
+
+
+size_t TFDH::integrateTrajectory(const Element& e, const PlasmaState& p, const double dv0,
+    const Stepper stepper, const Coordinate coordinate)
+{
+  return integrateODE(e, p, initialRadius(e, p), finalRadius(e, p), dv0, Extras::None,
+      stepper, coordinate).rs.size();
+}
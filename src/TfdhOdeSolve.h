@@ -2,6 +2,7 @@
 #ifndef TFDH_TFDH_ODE_SOLVE_H
 #define TFDH_TFDH_ODE_SOLVE_H
 
+#include "TfdhFunctions.h"
 #include "TfdhSolution.h"
 
 #include <vector>
@@ -11,7 +12,73 @@ class PlasmaState;
 
 
 namespace TFDH {
-  TfdhSolution solve(const Element& e, const PlasmaState& p);
+
+  // how the shooting parameter -- the initial slope of the potential -- is
+  // found: by plain bisection, down to adjacent doubles; by Newton steps
+  // using the variational equations of the ODE (safeguarded by bisection),
+  // down to a relative tolerance of 1e-12 on dv0, which takes fewer
+  // integrations of the ODE; or by multisection, integrating numThreads trial
+  // values at a time on as many threads of the ThreadPool (0 => one per core),
+  // which needs the fewest rounds and so has the lowest latency on an
+  // otherwise idle machine: a round costs a wake-up of the pool's threads,
+  // not a thread start, and they keep their GSL workspaces from round to round.
+  //
+  // TfdhIon, and so the sweeps and the CLI, always use Newton; the other two
+  // are only reached by calling solve() directly, and are kept as baselines
+  // and for latency experiments (make bench times all three)
+  enum class Shooting {Bisection, Newton, Multisection};
+
+  // the stepper integrating the ODE: GSL's explicit rk8pd, or its implicit
+  // Bulirsch-Stoer bsimp (Bader & Deuflhard) with the analytic Jacobian of the
+  // ODE. implicit steps cost more but aren't limited by stability, which pays
+  // off only if the explicit steps are: when the step cap of 0.2 r, at the
+  // ion sphere, spans very many screening lengths of the background plasma.
+  // chooseStepper() makes this call per (ion, plasma state), and solve()
+  // uses its choice; integrateTrajectory() takes either
+  enum class Stepper {Explicit, Implicit};
+  Stepper chooseStepper(const Element& e, const PlasmaState& p);
+
+  // the independent variable of the ODE: the radius r, with steps capped at
+  // 0.2 r; or s = ln r, with steps capped at 0.5 in s, and the state scaled
+  // to be of order 1. solve() uses r; ln r is opt-in, through
+  // integrateTrajectory()
+  enum class Coordinate {Radius, LogRadius};
+
+  TfdhSolution solve(const Element& e, const PlasmaState& p,
+      Shooting method=Shooting::Newton, unsigned numThreads=0);
+
+  // warm starts: the search for the shooting parameter dv0 begins at the
+  // given guess, or at the dv0 of a prior solution -- e.g. one at a nearby
+  // (rho,T) -- instead of at 0. a guess of 0 means "no guess"
+  TfdhSolution solve(const Element& e, const PlasmaState& p, double dv0Guess,
+      Shooting method=Shooting::Newton, unsigned numThreads=0);
+  TfdhSolution solve(const Element& e, const PlasmaState& p, const TfdhSolution& prior,
+      Shooting method=Shooting::Newton, unsigned numThreads=0);
+
+  // the global radial integrals of a solution, over the radii it spans
+  struct SolutionIntegrals {
+    const double numberBoundElectrons;
+    const double enclosedCharge; // net charge within tfdh.r.back(), in units of q_e
+    const EnergyDeltas embeddingEnergies;
+  };
+
+  // the integrals of a solution. the Newton shooting carries them as extra
+  // components of the ODE on its last trials, so for its solutions they come
+  // with the trajectory itself, its integrands evaluated on the ODE's own
+  // potential at the integrator's stages. for any other solution (from the
+  // other shootings, from solveRelaxation(), or rebuilt from its mesh) they
+  // are the quadratures over its spline: boundElectrons(), embeddingEnergy()
+  // and the same for the net charge
+  SolutionIntegrals integrals(const TfdhSolution& tfdh, const Element& e, const PlasmaState& p);
+
+  // the innermost pieces of solve(), for benchmarks (see Benchmarks.h): the
+  // right-hand side of the ODE for the state f = {u, du/dr} at r, and one
+  // integration of the ODE from the shooting parameter dv0 with the given
+  // stepper and coordinate, returning the number of points of the trajectory
+  void odeRhs(const Element& e, const PlasmaState& p, double r, const double f[2], double dfdr[2]);
+  size_t integrateTrajectory(const Element& e, const PlasmaState& p, double dv0, Stepper stepper,
+      Coordinate coordinate);
+
 }
 
 
@@ -2,30 +2,54 @@
 #ifndef TFDH_TFDH_SOLUTION_H
 #define TFDH_TFDH_SOLUTION_H
 
+#include "CubicSpline.h"
 #include "GslWrappers.h"
 
 #include <cassert>
+#include <cmath>
 #include <vector>
 
 
+// evaluation is thread-safe, and copies are independent (see CubicSpline).
+//
+// phi is interpolated through r phi, as a spline in ln r: near the ion,
+// where phi ~ Z qe / r, r phi is close to constant, so the interpolation
+// stays accurate on the sparse inner mesh of an integration in ln r
 class TfdhSolution : public GSL::FunctionObject {
   public:
-    TfdhSolution(const std::vector<double>& rs, const std::vector<double>& phis)
-      : r(rs), phi(phis), spline(r, phi)
+    TfdhSolution(const std::vector<double>& rs, const std::vector<double>& phis,
+        const double dv0, const std::vector<double>& trajectoryIntegrals={})
+      : r(rs), phi(phis), dv0(dv0), trajectoryIntegrals(trajectoryIntegrals),
+        spline(logs(r), products(r, phi))
     {
       assert(r.size()==phi.size());
       for (size_t i=0; i<r.size()-1; ++i)
         assert(r[i] < r[i+1] and "need monotonically increasing r");
     }
 
-    double operator()(double radius) const override {return spline.eval(radius);}
+    double operator()(double radius) const override {return spline.eval(std::log(radius)) / radius;}
 
   public:
     const std::vector<double> r;
     const std::vector<double> phi;
+    const double dv0; // the shooting parameter this solution was found with
+    // the integrals the solver carried along the solution's own trajectory,
+    // or none, see TFDH::integrals
+    const std::vector<double> trajectoryIntegrals;
 
   private:
-    GSL::Spline spline;
+    static std::vector<double> logs(const std::vector<double>& x) {
+      std::vector<double> result(x.size());
+      for (size_t i=0; i<x.size(); ++i) result[i] = std::log(x[i]);
+      return result;
+    }
+    static std::vector<double> products(const std::vector<double>& x, const std::vector<double>& y) {
+      std::vector<double> result(x.size());
+      for (size_t i=0; i<x.size(); ++i) result[i] = x[i] * y[i];
+      return result;
+    }
+
+    CubicSpline spline; // of r phi, in ln r
 };
 
 
@@ -1,9 +1,12 @@
 
 
+#include "Benchmarks.h"
 #include "Element.h"
 #include "Composition.h"
+#include "GridSweep.h"
 #include "PhysicalConstants.h"
 #include "PlasmaState.h"
+#include "SolutionCache.h"
 #include "TfdhIon.h"
 
 // Keep these handy for experiments
@@ -14,9 +17,12 @@
 //#include "TfdhSolution.h"
 
 #include <cassert>
+#include <cstdlib>
 #include <ctime>
+#include <iostream>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 
@@ -28,6 +34,10 @@ namespace Elements {
   const Element C(12, 6, "Carbon");
   const Element O(16, 8, "Oxygen");
   const Element Fe56(56, 26, "Iron-56");
+
+  // for looking up elements by the names used above, e.g. from the command line
+  const std::vector<std::pair<std::string, Element>> bySymbol = {
+    {"H", H}, {"He", He}, {"C", C}, {"O", O}, {"Fe56", Fe56}};
 } // namespace Elements
 
 
@@ -39,14 +49,174 @@ namespace {
     assert(std::strftime(str, sizeof(str), "%c", std::localtime(&t)));
     return std::string(str);
   }
+
+  std::vector<std::string> split(const std::string& s, const char delim) {
+    std::vector<std::string> tokens;
+    size_t start = 0;
+    for (size_t end=s.find(delim); end!=std::string::npos; end=s.find(delim, start)) {
+      tokens.push_back(s.substr(start, end-start));
+      start = end+1;
+    }
+    tokens.push_back(s.substr(start));
+    return tokens;
+  }
+
+  bool parseElement(const std::string& symbol, std::vector<Element>& elements) {
+    for (const auto& entry : Elements::bySymbol) {
+      if (entry.first == symbol) {
+        elements.push_back(entry.second);
+        return true;
+      }
+    }
+    std::cerr << "unknown element: " << symbol << "\n";
+    return false;
+  }
+
+  // either a list "x1,x2,..." or a log-spaced range "lo:hi:n"
+  bool parseAxis(const std::string& arg, std::vector<double>& values) {
+    const std::vector<std::string> range = split(arg, ':');
+    if (range.size()==3) {
+      const double lo = std::atof(range[0].c_str());
+      const double hi = std::atof(range[1].c_str());
+      const int n = std::atoi(range[2].c_str());
+      if (lo <= 0 or hi <= 0 or n <= 0) return false;
+      const std::vector<double> r = Sweep::logRange(lo, hi, n);
+      values.insert(values.end(), r.begin(), r.end());
+      return true;
+    }
+    for (const std::string& token : split(arg, ',')) {
+      const double x = std::atof(token.c_str());
+      if (x <= 0) return false;
+      values.push_back(x);
+    }
+    return true;
+  }
+
+  // a composition "He:0.7,H:0.3", given as mass fractions
+  bool parseComposition(const std::string& arg, std::vector<Composition>& comps) {
+    std::vector<Species> species;
+    for (const std::string& token : split(arg, ',')) {
+      const std::vector<std::string> pair = split(token, ':');
+      std::vector<Element> e;
+      if (pair.size()!=2 or not parseElement(pair[0], e)) return false;
+      species.push_back({std::atof(pair[1].c_str()), e.front()});
+    }
+    comps.push_back(Composition(species));
+    return true;
+  }
+
+  void printSweepUsage() {
+    std::cerr <<
+      "usage: tfdh sweep --rho AXIS --t AXIS --comp COMP [--comp COMP ...]\n"
+      "                  --ion SYMBOL [--ion SYMBOL ...] [--threads N] [--rel]\n"
+      "                  [--gfdi-table] [--relaxation] [--cache DIR] [--out FILE]\n"
+      "                  [--stats FILE]\n"
+      "  AXIS   list x1,x2,... or log-spaced range lo:hi:n\n"
+      "  COMP   mass fractions, e.g. He:0.7,H:0.3\n"
+      "  SYMBOL one of H, He, C, O, Fe56\n"
+      "  DIR    directory of solutions kept between runs, see SolutionCache.h\n"
+      "  --gfdi-table tabulates the electron density's gfdi, with --rel only\n"
+      "  --relaxation solves by relaxation rather than shooting, see TfdhBvpSolve.h\n"
+      "  --stats writes the cost of each point, from a build with make INSTRUMENT=1\n";
+  }
+
+  int runSweep(const int argc, char* argv[], const std::string& time) {
+    Sweep::Grid grid {{}, {}, {}, {}, false, false, TFDH::Method::Shooting};
+    unsigned numThreads = 0;
+    std::string filename = "sweep.data";
+    std::string statsFilename;
+
+    for (int i=2; i<argc; ++i) {
+      const std::string opt = argv[i];
+      if (opt == "--rel") {
+        grid.isRelativistic = true;
+        continue;
+      }
+      if (opt == "--gfdi-table") {
+        grid.tabulateGfdi = true;
+        continue;
+      }
+      if (opt == "--relaxation") {
+        grid.method = TFDH::Method::Relaxation;
+        continue;
+      }
+      if (i+1 >= argc) {
+        printSweepUsage();
+        return 1;
+      }
+      const std::string arg = argv[++i];
+      bool ok = true;
+      if (opt == "--rho") ok = parseAxis(arg, grid.rhos);
+      else if (opt == "--t") ok = parseAxis(arg, grid.temperatures);
+      else if (opt == "--comp") ok = parseComposition(arg, grid.compositions);
+      else if (opt == "--ion") ok = parseElement(arg, grid.traceIons);
+      else if (opt == "--threads") numThreads = std::atoi(arg.c_str());
+      else if (opt == "--cache") SolutionCache::setDirectory(arg);
+      else if (opt == "--out") filename = arg;
+      else if (opt == "--stats") statsFilename = arg;
+      else ok = false;
+      if (not ok) {
+        std::cerr << "bad argument: " << opt << " " << arg << "\n";
+        printSweepUsage();
+        return 1;
+      }
+    }
+    if (grid.size()==0) {
+      printSweepUsage();
+      return 1;
+    }
+
+    const std::vector<Sweep::Row> rows = Sweep::run(grid, numThreads);
+    Sweep::printRowsToFile(filename, grid, rows, time);
+    if (not statsFilename.empty()) Sweep::printStatsToFile(statsFilename, grid, rows, time);
+    return 0;
+  }
+
+  int runBenchmarks(const int argc, char* argv[], const std::string& time) {
+    std::string label = "<no label given>";
+    std::string filename = "bench.data";
+    for (int i=2; i+1<argc; i+=2) {
+      const std::string opt = argv[i];
+      if (opt == "--label") label = argv[i+1];
+      else if (opt == "--out") filename = argv[i+1];
+      else {
+        std::cerr << "usage: tfdh bench [--label LABEL] [--out FILE]\n";
+        return 1;
+      }
+    }
+    Bench::printResultsToFile(filename, Bench::run(), label, time);
+    return 0;
+  }
 } // anon namespace
 
 
 
-int main() {
+int main(int argc, char* argv[]) {
 
   std::string time = getTime();
 
+  if (argc > 1 and std::string(argv[1]) == "sweep") {
+    return runSweep(argc, argv, time);
+  }
+  if (argc > 1 and std::string(argv[1]) == "bench") {
+    return runBenchmarks(argc, argv, time);
+  }
+  // --binary writes the results in the format of ColumnarFile.h instead;
+  // --relaxation solves by relaxation rather than shooting
+  bool binary = false;
+  TFDH::Method method = TFDH::Method::Shooting;
+  for (int i=1; i<argc; ++i) {
+    const std::string opt = argv[i];
+    if (opt == "--binary") binary = true;
+    else if (opt == "--relaxation") method = TFDH::Method::Relaxation;
+    else {
+      std::cerr << "usage: tfdh [--binary] [--relaxation]\n"
+        "       tfdh sweep ...\n"
+        "       tfdh bench ...\n";
+      return 1;
+    }
+  }
+
   const double rho = 1e3;
   const double t = 1e8;
   const double kt = t * PhysicalConstantsCGS::KBoltzmann;
@@ -54,9 +224,14 @@ int main() {
   const auto species = std::vector<Species> {{ {0.7, Elements::He}, {0.3, Elements::H} }};
   const PlasmaState ps(rho, kt, Composition(species), false);
 
-  const TfdhIon ion(ps, Elements::Fe56);
-  ion.printSummaryToFile("summary.data", time);
-  ion.printRadialProfileToFile("profile.data", time);
+  const TfdhIon ion(ps, Elements::Fe56, method);
+  if (binary) {
+    ion.writeSummaryToBinaryFile("summary.bin", time);
+    ion.writeRadialProfileToBinaryFile("profile.bin", time);
+  } else {
+    ion.printSummaryToFile("summary.data", time);
+    ion.printRadialProfileToFile("profile.data", time);
+  }
 
   return 0;
 }